@@ -1,6 +1,8 @@
 #pragma once
 
 // STL modules
+#include <array>
+#include <condition_variable>
 #include <string>
 #include <functional>
 #include <mutex>
@@ -24,12 +26,18 @@ namespace kb {
 #include "bot/locale/locale.hpp"
 #include "bot/info.hpp"
 #include "bot/player.hpp"
+#include "core/scheduler.hpp"
 #include "ytcpp/item.hpp"
 
 namespace kb {
 
 namespace Bot
 {
+    namespace BotConst
+    {
+        constexpr size_t GuildLockShards = 64;      // Count of locks guild-scoped state is partitioned into
+    }
+
     class Bot : public dpp::cluster
     {
     private:
@@ -39,6 +47,14 @@ namespace Bot
         // Bot player map entry
         using PlayerEntry = std::map<dpp::snowflake, Player>::iterator;
 
+        enum class PresenceType
+        {
+            GuildsServed,
+            SessionsConducted,
+            TracksPlayed,
+            MaxPresenceTypes,
+        };
+
         struct JoinStatus
         {
             enum class Result
@@ -82,9 +98,16 @@ namespace Bot
 
     private:
         spdlog::logger m_logger;
-        std::mutex m_mutex;
-        std::thread m_presenceThread;
+        std::array<std::mutex, BotConst::GuildLockShards> m_guildMutexes;
+        PresenceType m_presenceType = PresenceType::GuildsServed;
+        std::mutex m_presenceMutex;
+        std::condition_variable m_presenceCv;
+        Scheduler::TimerId m_presenceTimer = 0;
+        bool m_presenceRunning = false;
+        bool m_presenceStopped = false;
+        std::mutex m_playersMutex;
         std::map<dpp::snowflake, Player> m_players;
+        std::mutex m_ephemeralTokensMutex;
         std::map<dpp::snowflake, std::string> m_ephemeralTokens;
 
     public:
@@ -92,9 +115,30 @@ namespace Bot
         /// @param registerCommands Wherther or not to register commands and exit
         Bot(bool registerCommands = false);
 
+        /// @brief Stop events, background tasks and players before the bot's state is destroyed
+        ~Bot();
+
     private:
-        /// @brief Presence thread implementation
-        void presenceFunction();
+        /// @brief Schedule presence update. Must be called with the presence mutex locked.
+        /// @param delay Time to wait before the update
+        void schedulePresence(Scheduler::Clock::duration delay);
+
+        /// @brief Show next presence and schedule its update at the start of a minute
+        void updatePresence();
+
+        /// @brief Find guild's player. Must be called with the guild's mutex locked: the entry stays valid until the guild's player is erased.
+        /// @param guildId ID of guild
+        /// @return Guild's player entry or m_players.end() if there is no player
+        PlayerEntry findPlayer(dpp::snowflake guildId);
+
+        /// @brief Destroy guild's player. Must be called with the guild's mutex locked.
+        /// @param guildId ID of guild
+        void erasePlayer(dpp::snowflake guildId);
+
+        /// @brief Take guild's ephemeral message token
+        /// @param messageId ID of ephemeral message
+        /// @return The token or empty string if there is no token for the message
+        std::string takeEphemeralToken(dpp::snowflake messageId);
 
         /// @brief Update ephemeral message token 
         /// @param confirmationEvent Message confirmation event
@@ -181,13 +225,19 @@ namespace Bot
         void onVoiceTrackMarker(const dpp::voice_track_marker_t& event);
     
     public:
-        /// @brief Leave voice channel
+        /// @brief Get mutex guarding guild-scoped state: guild's player and info changes
+        /// @param guildId ID of guild
+        /// @return Guild's mutex, shared with some other guilds
+        std::mutex& guildMutex(dpp::snowflake guildId);
+
+        /// @brief Leave voice channel. Must be called with the guild's mutex locked.
         /// @param client Discord client serving guild
         /// @param guild Voice channel's guild
         /// @param info Guild's info
         /// @param reason Leave reason
+        /// @param sessionNumber Number of session to end or 0 to end any. Other sessions are left as they are.
         /// @return Leave status
-        LeaveStatus leaveVoice(dpp::discord_client* client, const dpp::guild& guild, Info& info, Locale::EndReason reason);
+        LeaveStatus leaveVoice(dpp::discord_client* client, const dpp::guild& guild, Info& info, Locale::EndReason reason, uint64_t sessionNumber = 0);
     };
 }
 
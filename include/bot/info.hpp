@@ -6,9 +6,6 @@
 // Library DPP
 #include <dpp/dpp.h>
 
-// Library spdlog
-#include <spdlog/spdlog.h>
-
 // Custom modules
 #include "bot/types.hpp"
 
@@ -45,19 +42,19 @@ namespace Bot
         static Stats GetGlobalStats();
 
     private:
-        spdlog::logger m_logger;
-        std::string m_filePath;
+        dpp::snowflake m_guildId;
         Settings m_previousSettings;
         Settings m_settings;
         Stats m_previousStats;
         Stats m_stats;
 
     public:
-        /// @brief Initialize guild info
+        /// @brief Initialize guild info from info cache
         /// @param guildId ID of guild
         /// @throw std::runtime_error if internal error occurs
         Info(dpp::snowflake guildId);
 
+        /// @brief Apply changes made to the info to info cache
         ~Info();
 
     public:
@@ -0,0 +1,107 @@
+#pragma once
+
+// STL modules
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Library DPP
+#include <dpp/dpp.h>
+
+// Library spdlog
+#include <spdlog/spdlog.h>
+
+// Custom modules
+#include "bot/info_storage.hpp"
+#include "bot/types.hpp"
+
+namespace kb {
+
+namespace Bot
+{
+    namespace InfoCacheConst
+    {
+        constexpr size_t ShardCount = 16;                       // Count of independently locked parts of the cache
+        constexpr std::chrono::seconds FlushInterval(5);        // Time changed info waits before it is written to disk
+        constexpr uint64_t FlushPoolKey = 1;                    // Blocking pool key of flushes, no guild has such a small ID
+    }
+
+    class InfoCache
+    {
+    private:
+        struct Entry
+        {
+            Settings settings;
+            Stats stats;
+            bool dirty = false;
+        };
+
+        struct Shard
+        {
+            std::mutex mutex;
+            std::unordered_map<uint64_t, Entry> entries;
+        };
+
+    private:
+        spdlog::logger m_logger;
+        std::array<Shard, InfoCacheConst::ShardCount> m_shards;
+        std::mutex m_flushMutex;
+        std::unique_ptr<InfoStorage> m_storage;
+        std::atomic<bool> m_flushScheduled;
+        std::mutex m_globalStatsMutex;
+        Stats m_globalStats;
+
+    private:
+        InfoCache();
+
+        static inline InfoCache& Instance()
+        {
+            static InfoCache instance;
+            return instance;
+        }
+
+    private:
+        /// @brief Get shard holding guild's entry
+        /// @param guildId ID of guild
+        /// @return Guild's shard
+        Shard& shard(uint64_t guildId);
+
+        /// @brief Get guild's entry, creating default one for unknown guild. Must be called with the shard's mutex locked.
+        /// @param shard Guild's shard
+        /// @param guildId ID of guild
+        /// @return Guild's entry
+        Entry& entry(Shard& shard, uint64_t guildId);
+
+        /// @brief Schedule flush of changed entries on the blocking pool if it isn't scheduled yet
+        void scheduleFlush();
+
+    public:
+        /// @brief Read info of all guilds from info storage and seed global stats. Must be called once before info is used.
+        /// @throw std::runtime_error if info storage can't be read
+        static void Load();
+
+        /// @brief Get stats of all guilds
+        /// @return Global stats
+        static Stats GlobalStats();
+
+        /// @brief Get copy of guild's info
+        /// @param guildId ID of guild
+        /// @param settings Settings to copy to
+        /// @param stats Stats to copy to
+        static void Get(dpp::snowflake guildId, Settings& settings, Stats& stats);
+
+        /// @brief Apply changes to guild's info. It is written to disk later.
+        /// @param guildId ID of guild
+        /// @param settings New settings: nullptr if settings weren't changed
+        /// @param statsIncrement Values to add to stats
+        static void Update(dpp::snowflake guildId, const Settings* settings, const Stats& statsIncrement);
+
+        /// @brief Write all changed info to disk now
+        static void Flush();
+    };
+}
+
+} // namespace kb
@@ -0,0 +1,124 @@
+#pragma once
+
+// STL modules
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Library spdlog
+#include <spdlog/spdlog.h>
+
+// Custom modules
+#include "bot/types.hpp"
+
+namespace kb {
+
+namespace Bot
+{
+    namespace InfoStorageConst
+    {
+        // Info log file name inside info directory
+        constexpr const char* LogFilename = "info.log";
+
+        constexpr const char LogMagic[8] = { 'K', 'B', 'I', 'N', 'F', 'O', '0', '1' };   // First bytes of every info log file
+        constexpr size_t CompactionRatio = 4;           // Log is compacted when it holds this many records per guild...
+        constexpr size_t MinCompactionRecords = 1024;   // ...and at least this many records in total
+    }
+
+    class InfoStorage
+    {
+    public:
+        struct Record
+        {
+            uint64_t guildId = 0;
+            Settings settings;
+            Stats stats;
+        };
+
+        using Records = std::vector<Record>;
+
+    public:
+        virtual ~InfoStorage() = default;
+
+    public:
+        /// @brief Read info of all guilds
+        /// @throw std::runtime_error if the storage can't be read
+        /// @return The latest record of every stored guild
+        virtual Records load() = 0;
+
+        /// @brief Store info of guilds, replacing their previous records
+        /// @param records Records to store
+        /// @return True if all records were stored
+        virtual bool write(const Records& records) = 0;
+    };
+
+    /// @brief Legacy storage: one JSON file per guild in info directory
+    class JsonInfoStorage : public InfoStorage
+    {
+    private:
+        spdlog::logger m_logger;
+        std::string m_directory;
+
+    public:
+        /// @brief Use info directory
+        /// @param directory Path to the directory
+        JsonInfoStorage(const std::string& directory);
+
+    private:
+        /// @brief Get path of guild's info file
+        /// @param guildId ID of guild
+        /// @return Info file path
+        std::string filePath(uint64_t guildId) const;
+
+    public:
+        /// @brief Read all info files of the directory. Files that can't be parsed are skipped.
+        /// @throw std::runtime_error if the directory can't be read
+        /// @return Record of every info file
+        Records load() override;
+
+        /// @brief Write info files, replacing every old one at once
+        /// @param records Records to write
+        /// @return True if all files were written
+        bool write(const Records& records) override;
+    };
+
+    /// @brief Single append-only file of checksummed records, compacted when old records pile up
+    class LogInfoStorage : public InfoStorage
+    {
+    private:
+        spdlog::logger m_logger;
+        std::string m_path;
+        size_t m_recordCount;
+        std::unordered_set<uint64_t> m_guildIds;
+
+    public:
+        /// @brief Use info log file. It is created on first write if it doesn't exist.
+        /// @param path Path to the file
+        LogInfoStorage(const std::string& path);
+
+    private:
+        /// @brief Read the latest records from log file, cutting off damaged tail
+        /// @param recordCount Count of all records in the file, including outdated ones
+        /// @throw std::runtime_error if the file can't be read
+        /// @return The latest record of every guild
+        Records read(size_t& recordCount);
+
+        /// @brief Write all current records to a new log file and replace the old one with it
+        /// @return True if the log was compacted
+        bool compact();
+
+    public:
+        /// @brief Read the latest record of every guild from log file
+        /// @throw std::runtime_error if the file can't be read
+        /// @return The latest record of every guild
+        Records load() override;
+
+        /// @brief Append records to log file and wait until they reach the disk
+        /// @param records Records to append
+        /// @return True if all records were appended
+        bool write(const Records& records) override;
+    };
+}
+
+} // namespace kb
@@ -0,0 +1,89 @@
+#pragma once
+
+// STL modules
+#include <chrono>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <ytcpp/item.hpp>
+
+namespace kb {
+
+namespace Bot
+{
+    namespace ItemCacheConst
+    {
+        constexpr size_t MaxItems = 1024;                   // Count of items kept in memory, least recently used ones are resolved again
+        constexpr std::chrono::minutes ItemTtl(30);         // Time after which items are resolved again, so livestream and premiere flags stay current
+    }
+
+    /*
+    *   Shared cache of resolved videos and playlists.
+    *   Concurrent requests for the same item wait for one request to YouTube.
+    *   Queues hold the items they were given, so expiration and eviction only affect new lookups.
+    */
+    class ItemCache
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<const ytcpp::Item> item;
+            Clock::time_point expiration;
+            std::list<std::string>::iterator usage;
+        };
+
+    private:
+        std::mutex m_mutex;
+        std::unordered_map<std::string, Entry> m_entries;
+        std::list<std::string> m_usage;
+        std::unordered_map<std::string, std::shared_future<std::shared_ptr<const ytcpp::Item>>> m_pendingItems;
+
+    private:
+        ItemCache() = default;
+
+        static inline ItemCache& Instance()
+        {
+            static ItemCache instance;
+            return instance;
+        }
+
+    private:
+        /// @brief Find unexpired item and mark it as recently used. Must be called with the mutex locked.
+        /// @param itemId ID of item
+        /// @return Cached item or nullptr if it isn't cached
+        std::shared_ptr<const ytcpp::Item> find(const std::string& itemId);
+
+        /// @brief Cache item, evicting least recently used ones. Must be called with the mutex locked.
+        /// @param itemId ID of item
+        /// @param item The item
+        void insert(const std::string& itemId, std::shared_ptr<const ytcpp::Item> item);
+
+    public:
+        /// @brief Get ID of item
+        /// @param item The item
+        /// @return Video or playlist ID
+        static std::string ItemId(const ytcpp::Item& item);
+
+        /// @brief Cache resolved item
+        /// @param item The item
+        /// @return The cached item, shared with later lookups
+        static std::shared_ptr<const ytcpp::Item> Put(const ytcpp::Item& item);
+
+        /// @brief Get item, resolving it or joining a running resolution if it isn't cached
+        /// @param type Type of item
+        /// @param itemId ID of item
+        /// @throw ytcpp::Error if the item can't be resolved
+        /// @return The item
+        static std::shared_ptr<const ytcpp::Item> Get(ytcpp::Item::Type type, std::string_view itemId);
+    };
+}
+
+} // namespace kb
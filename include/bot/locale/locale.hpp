@@ -301,7 +301,7 @@ namespace Bot
         /// @param session Player session
         /// @throw std::runtime_error if reason is unknown
         /// @return Normal message
-        static dpp::message EndMessage(const EndStrings& strings, const Settings& settings, EndReason reason, Session session);
+        static dpp::message EndMessage(const EndStrings& strings, const Settings& settings, EndReason reason, const Session& session);
 
     public:
         /// @brief Get locale type
@@ -423,6 +423,10 @@ namespace Bot
         /// @return Ephemeral message
         virtual inline dpp::message unknownError() = 0;
 
+        /// @brief Create "I'm too busy" message
+        /// @return Ephemeral message
+        virtual inline dpp::message busy() = 0;
+
         /// @brief Create "Item added to queue" message
         /// @param item Added item
         /// @param paused Whether or not to display paused player warning
@@ -537,7 +541,7 @@ namespace Bot
         /// @param session Player session
         /// @throw std::runtime_error if reason is unknown
         /// @return Normal message
-        virtual inline dpp::message sessionEnd(const Settings& settings, EndReason reason, Session session) = 0;
+        virtual inline dpp::message sessionEnd(const Settings& settings, EndReason reason, const Session& session) = 0;
 
         /// @brief Create "Not playing" string
         /// @return "Not playing" string
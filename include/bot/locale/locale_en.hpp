@@ -363,6 +363,11 @@ namespace Bot
             return ErrorMessage("Sorry, something went wrong");
         }
 
+        virtual inline dpp::message busy()
+        {
+            return ProblemMessage("Sorry, I'm too busy right now, try again in a moment");
+        }
+
         /// @brief Create "Item added to queue" message
         /// @param item Added item
         /// @param paused Whether or not to display paused player warning
@@ -597,7 +602,7 @@ namespace Bot
         /// @param session Player session
         /// @throw std::runtime_error if reason is unknown
         /// @return Normal message
-        virtual inline dpp::message sessionEnd(const Settings& settings, EndReason reason, Session session)
+        virtual inline dpp::message sessionEnd(const Settings& settings, EndReason reason, const Session& session)
         {
             EndStrings strings = {};
             strings.sessionInfo = "{}'s session #{} ended";
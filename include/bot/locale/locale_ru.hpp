@@ -371,6 +371,11 @@ namespace Bot
             return ErrorMessage("Извини, что-то пошло не так");
         }
 
+        virtual inline dpp::message busy()
+        {
+            return ProblemMessage("Извини, я сейчас слишком занят, попробуй ещё раз чуть позже");
+        }
+
         /// @brief Create "item added" message
         /// @param item Item in question
         /// @param paused Whether or not to display paused player warning
@@ -603,7 +608,7 @@ namespace Bot
         /// @param session Player session
         /// @throw std::runtime_error if reason is unknown
         /// @return Normal message
-        virtual inline dpp::message sessionEnd(const Settings& settings, EndReason reason, Session session)
+        virtual inline dpp::message sessionEnd(const Settings& settings, EndReason reason, const Session& session)
         {
             EndStrings strings = {};
             strings.sessionInfo = "Сессия #{1} пользователя {0} закончилась";
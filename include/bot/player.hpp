@@ -2,8 +2,15 @@
 
 // STL modules
 #include <string>
+#include <atomic>
+#include <memory>
 #include <mutex>
 #include <thread>
+#include <condition_variable>
+#include <exception>
+#include <optional>
+#include <chrono>
+#include <functional>
 
 // Library DPP
 #include <dpp/dpp.h>
@@ -13,6 +20,7 @@
 
 /* Forward kb::Bot::Player class declaration for other modules */
 namespace kb {
+    class Downloader;
     namespace Bot {
         class Player;
     }
@@ -23,6 +31,8 @@ namespace kb {
 #include "bot/session.hpp"
 #include "bot/signal.hpp"
 #include "bot/timeout.hpp"
+#include "core/scheduler.hpp"
+#include "core/stopwatch.hpp"
 #include "ytcpp/item.hpp"
 
 namespace kb {
@@ -33,16 +43,33 @@ namespace pt = boost::posix_time;
 
 namespace Bot
 {
+    namespace PlayerConst
+    {
+        constexpr int MaxBatchFrames = 50;                              // Maximum count of frames sent in one playback step
+        constexpr std::chrono::milliseconds DownloadPollInterval(50);   // Time to wait for the download when decoding would block
+    }
+
     class Player
     {
     private:
-        enum class ThreadStatus
+        enum class PlaybackStatus
         {
             Idle,
             Running,
             Stopped,
         };
 
+        struct Prefetch
+        {
+            std::mutex mutex;
+            std::string videoId;
+            std::unique_ptr<Downloader> downloader;
+            std::exception_ptr error;
+            Scheduler::Task onFinished;
+            bool finished = false;
+            bool discarded = false;
+        };
+
     private:
         // Common members
         spdlog::logger m_logger;
@@ -50,11 +77,24 @@ namespace Bot
         Timeout m_timeout;
         dpp::discord_client* m_client;
         Session m_session;
+        std::atomic<std::shared_ptr<const Session>> m_sessionSnapshot;
+        Stopwatch m_joinStopwatch;
 
-        // Threading members
+        // Playback members
         std::mutex m_mutex;
-        std::thread m_thread;
-        ThreadStatus m_threadStatus = ThreadStatus::Idle;
+        std::condition_variable m_cv;
+        PlaybackStatus m_playbackStatus = PlaybackStatus::Idle;
+        Scheduler::TimerId m_playbackTimer = 0;
+        std::string m_playbackVideoId;
+        std::unique_ptr<Downloader> m_downloader;
+        std::shared_ptr<Prefetch> m_opening;
+        std::shared_ptr<Prefetch> m_prefetch;
+        Stopwatch m_playbackStopwatch;
+        bool m_firstAudioSent = false;
+/* Temporarily unsupported!
+        ytcpp::Video::Chapter m_lastChapter;
+        pt::time_duration m_lastCheckTimestamp;
+*/
 
     public:
         /// @brief Initialize player
@@ -68,10 +108,46 @@ namespace Bot
         ~Player();
 
     private:
+        /// @brief Add item to the end of queue
+        /// @param item Item to add
+        /// @param requester User that requested the item to be added
+        void enqueue(const ytcpp::Item& item, const dpp::user& requester);
+
         /// @brief Extract next video from queue or playlist iterator
         /// @param info Guild's info
         void extractNextVideo(const Info& info);
 
+        /// @brief Get ID of video that will be played after the current one
+        /// @return ID of the next video: empty if there is nothing to prefetch
+        std::string nextVideoId();
+
+        /// @brief Run downloader operation on the blocking pool and store its result in prefetch
+        /// @param guildId ID of player's guild, operations of one guild take turns with other guilds
+        /// @param prefetch Prefetch holding the downloader to operate on, if there is one
+        /// @param operation Operation opening or changing the downloader, the downloader is dropped if it throws
+        static void RunPrefetch(dpp::snowflake guildId, const std::shared_ptr<Prefetch>& prefetch, std::function<void(std::unique_ptr<Downloader>&)> operation);
+
+        /// @brief Start opening video's downloader on the blocking pool
+        /// @param guildId ID of player's guild, opens of one guild take turns with other guilds
+        /// @param videoId ID of video to open
+        /// @return Prefetch finished when the downloader is opened or fails to open
+        static std::shared_ptr<Prefetch> StartPrefetch(dpp::snowflake guildId, const std::string& videoId);
+
+        /// @brief Start seeking downloader on the blocking pool
+        /// @param guildId ID of player's guild, seeks of one guild take turns with other guilds
+        /// @param videoId ID of downloader's video
+        /// @param downloader Downloader to seek
+        /// @param timestamp Timestamp to seek to in seconds
+        /// @return Prefetch finished when the downloader is seeked or fails to seek
+        static std::shared_ptr<Prefetch> StartSeek(dpp::snowflake guildId, const std::string& videoId, std::unique_ptr<Downloader> downloader, int64_t timestamp);
+
+        /// @brief Start prefetching the next video or discard prefetch that is no longer needed
+        void updatePrefetch();
+
+        /// @brief Discard prefetched video
+        /// @param prefetch Prefetch to discard
+        void discardPrefetch(std::shared_ptr<Prefetch>& prefetch);
+
         /// @brief Increment count of played tracks
         /// @param info Guild's info
         void incrementPlayedTracks(Info& info);
@@ -83,7 +159,10 @@ namespace Bot
         void chapterReached(const Youtube::Video::Chapter& chapter, const Info& info);
 */
         
-        /// @brief Start send thread if there is a playing video or enable timeout
+        /// @brief Publish copy of the session for readers. Must be called with the mutex locked after the session is changed.
+        void publishSession();
+
+        /// @brief Start playback if there is a playing video or enable timeout
         void checkPlayingVideo();
 
         /// @brief Set voice channel status
@@ -94,19 +173,34 @@ namespace Bot
         /// @param info Guild's info
         void updateStatus(const Info& info);
 
-        /// @brief Send thread implementation
-        void threadFunction();
+        /// @brief Playback task: opens the playing video, sends a batch of frames and yields
+        void playbackStep();
+
+        /// @brief Playback step implementation
+        /// @throw std::runtime_error if internal error occurs
+        void playFrames();
+
+        /// @brief Run playback step after delay
+        /// @param delay Time to wait before the step
+        void schedulePlayback(Scheduler::Clock::duration delay);
+
+        /// @brief Run playback step now if it's waiting for a timer or an opening downloader
+        void wakePlayback();
+
+        /// @brief Release playback resources and set playback idle. Must be called with the mutex locked.
+        /// @param signalType Marker to insert after the sent audio: none if playback was cancelled
+        void finishPlayback(std::optional<Signal::Type> signalType);
 
         /// @brief Get current voice client
         /// @return Current voice client
         dpp::discord_voice_client* getVoiceClient();
 
-        /// @brief Start send thread
-        void startThread();
+        /// @brief Start playing the playing video
+        void startPlayback();
 
-        /// @brief Stop send thread
+        /// @brief Stop playback and wait until its step isn't running
         /// @param lock Acquired mutex lock
-        void stopThread(std::unique_lock<std::mutex>& lock);
+        void stopPlayback(std::unique_lock<std::mutex>& lock);
 
         /// @brief Signal bot to disconnect from voice channel
         /// @param reason Session end reason
@@ -138,9 +232,23 @@ namespace Bot
         /// @param endpoint Endpoint to update to
         void updateVoiceServerEndpoint(const std::string& endpoint);
 
-        /// @brief Get player session
-        /// @return Player session
-        Session session();
+        /// @brief Get snapshot of player session. It doesn't lock the player and isn't affected by later changes.
+        /// @return Player session snapshot
+        std::shared_ptr<const Session> session() const;
+
+        /// @brief Get number of player's session
+        /// @return Session number
+        inline uint64_t sessionNumber() const
+        {
+            return m_session.number;
+        }
+
+        /// @brief Get ID of player's voice channel
+        /// @return Voice channel ID
+        inline dpp::snowflake voiceChannelId() const
+        {
+            return m_session.voiceChannelId;
+        }
 
         /// @brief Add item to player's queue
         /// @param item Item to add
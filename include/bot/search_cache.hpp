@@ -0,0 +1,97 @@
+#pragma once
+
+// STL modules
+#include <chrono>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <ytcpp/search.hpp>
+
+namespace kb {
+
+namespace Bot
+{
+    namespace SearchCacheConst
+    {
+        constexpr size_t MaxResults = 256;                      // Count of search results kept in memory, least recently used ones are searched again
+        constexpr std::chrono::minutes ResultsTtl(10);          // Time after which search results are searched again
+    }
+
+    /*
+    *   Shared cache of search results.
+    *   Concurrent identical searches wait for one request to YouTube.
+    */
+    class SearchCache
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Results = std::shared_ptr<const ytcpp::SearchResults>;
+
+    private:
+        struct Entry
+        {
+            Results results;
+            Clock::time_point expiration;
+            std::list<std::string>::iterator usage;
+        };
+
+    private:
+        std::mutex m_mutex;
+        std::unordered_map<std::string, Entry> m_entries;
+        std::list<std::string> m_usage;
+        std::unordered_map<std::string, std::shared_future<Results>> m_pendingSearches;
+
+    private:
+        SearchCache() = default;
+
+        static inline SearchCache& Instance()
+        {
+            static SearchCache instance;
+            return instance;
+        }
+
+    private:
+        /// @brief Find unexpired results and mark them as recently used. Must be called with the mutex locked.
+        /// @param key Key of results
+        /// @return Cached results or nullptr if they aren't cached
+        Results find(const std::string& key);
+
+        /// @brief Cache results, evicting least recently used ones. Must be called with the mutex locked.
+        /// @param key Key of results
+        /// @param results The results
+        void insert(const std::string& key, Results results);
+
+        /// @brief Get cached results or search, joining an identical search if one is running
+        /// @param key Key of results
+        /// @param search Function doing the search
+        /// @throw Whatever search throws
+        /// @return The results
+        Results get(const std::string& key, const std::function<ytcpp::SearchResults()>& search);
+
+        /// @brief Make identical queries share a key: trim, collapse whitespace and lowercase ASCII letters
+        /// @param query Search query
+        /// @return Normalized query
+        static std::string NormalizeQuery(std::string_view query);
+
+    public:
+        /// @brief Search YouTube by query
+        /// @param query Search query
+        /// @throw std::runtime_error if the search fails
+        /// @return Search results
+        static Results QuerySearch(const std::string& query);
+
+        /// @brief Search videos related to video
+        /// @param videoId ID of video
+        /// @throw std::runtime_error if the search fails
+        /// @return Search results
+        static Results RelatedSearch(const std::string& videoId);
+    };
+}
+
+} // namespace kb
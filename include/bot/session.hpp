@@ -1,7 +1,12 @@
 #pragma once
 
 // STL modules
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
 // Library DPP
 #include <dpp/dpp.h>
@@ -17,10 +22,14 @@ namespace Bot
 {
     struct Session
     {
+        /*
+        *   Compact queue entry: item metadata is shared with the item cache and other queues,
+        *   requesters are stored once per session.
+        */
         struct EnqueuedItem
         {
-            ytcpp::Item item;
-            dpp::user requester;
+            std::shared_ptr<const ytcpp::Item> item;
+            uint32_t requesterIndex;
         };
 
         struct PlayingVideo
@@ -54,8 +63,17 @@ namespace Bot
         std::optional<PlayingVideo> playingVideo;
         std::optional<PlayingPlaylist> playingPlaylist;
         std::optional<dpp::user> playingRequester;
+        std::vector<dpp::user> requesters;
         std::deque<EnqueuedItem> queue;
         int64_t seekTimestamp = -1;
+
+        /// @brief Get user that enqueued item
+        /// @param item The enqueued item
+        /// @return Item's requester
+        inline const dpp::user& requester(const EnqueuedItem& item) const
+        {
+            return requesters[item.requesterIndex];
+        }
     };
 }
 
@@ -2,10 +2,11 @@
 
 // STL modules
 #include <mutex>
-#include <thread>
-#include <condition_variable>
 #include <functional>
 
+// Custom modules
+#include "core/timer_wheel.hpp"
+
 namespace kb {
 
 namespace Bot
@@ -13,15 +14,13 @@ namespace Bot
     class Timeout
     {
     public:
-        // Function called when timeout occurs
+        // Function called on timer wheel thread when timeout occurs: must not block
         using Callback = std::function<void()>;
 
     private:
         mutable std::mutex m_mutex;
-        std::thread m_thread;
-        std::condition_variable m_cv;
         uint64_t m_timeoutDuration;
-        bool m_enabled;
+        TimerWheel::TimerId m_timerId;
         Callback m_callback;
 
     public:
@@ -35,8 +34,8 @@ namespace Bot
         ~Timeout();
 
     private:
-        /// @brief Timeout thread implementation
-        void threadFunction();
+        /// @brief Timer callback
+        void expire();
 
     public:
         /// @brief Set new timeout duration
@@ -52,6 +52,11 @@ namespace Bot
         /// @return Reference to these stats
         Stats& operator+=(const Stats& other);
 
+        /// @brief Subtract other stats
+        /// @param other Other stats to subtract
+        /// @return Reference to these stats
+        Stats& operator-=(const Stats& other);
+
         /// @brief Check if stats are equal
         /// @param other Other stats to check against
         /// @return True if both stats are equal
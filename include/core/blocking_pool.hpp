@@ -0,0 +1,176 @@
+#pragma once
+
+// STL modules
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Library spdlog
+#include <spdlog/spdlog.h>
+
+// Custom modules
+#include "core/scheduler.hpp"
+
+namespace kb {
+
+namespace BlockingPoolConst
+{
+    constexpr size_t Workers = 8;                               // Count of threads running interactive tasks
+    constexpr size_t MaxQueuedTasks = 64;                       // Count of waiting interactive tasks after which new ones are rejected
+    constexpr size_t MaxQueuedKeyTasks = 4;                     // Count of waiting interactive tasks of one key after which its new ones are rejected
+    constexpr size_t BackgroundWorkers = 8;                     // Count of threads running background tasks
+    constexpr size_t MaxQueuedBackgroundTasks = 256;            // Count of waiting background tasks after which new deferred ones are rejected
+    constexpr size_t MaxQueuedBackgroundKeyTasks = 16;          // Count of waiting background tasks of one key after which its new deferred ones are rejected
+    constexpr std::chrono::minutes MetricsInterval(1);          // Time between metrics reports
+}
+
+/*
+*   Bounded pool for tasks that block on upstream services.
+*   Keys (guilds) take turns, so a burst from one key doesn't delay the others.
+*   Interactive tasks and background tasks have their own threads and limits,
+*   so the pool only reports being busy because of user load.
+*/
+class BlockingPool
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    enum class Priority
+    {
+        Interactive,    // Tasks users wait for: rejected ones are answered with "busy" reply
+        Background,     // Tasks running behind the scenes: prefetches, flushes, disconnects
+    };
+
+    struct Metrics
+    {
+        size_t queuedTasks = 0;                 // Tasks waiting for a thread now
+        size_t runningTasks = 0;                // Tasks running now
+        uint64_t acceptedTasks = 0;             // Tasks accepted since the last report
+        uint64_t rejectedTasks = 0;             // Tasks rejected since the last report
+        Clock::duration averageWait = {};       // Average time tasks started since the last report waited for a thread
+        Clock::duration maxWait = {};           // Longest time a task started since the last report waited for a thread
+    };
+
+private:
+    struct QueuedTask
+    {
+        Task task;
+        Clock::time_point submitTime;
+    };
+
+    // Threads and queues of one priority
+    struct Lane
+    {
+        size_t maxQueuedTasks = 0;
+        size_t maxQueuedKeyTasks = 0;
+        std::condition_variable cv;
+        std::vector<std::thread> threads;
+        std::unordered_map<uint64_t, std::deque<QueuedTask>> queues;
+        std::deque<uint64_t> readyKeys;
+        size_t queuedTasks = 0;
+        size_t runningTasks = 0;
+
+        // Metrics since the last report
+        uint64_t acceptedTasks = 0;
+        uint64_t rejectedTasks = 0;
+        uint64_t startedTasks = 0;
+        Clock::duration totalWait = {};
+        Clock::duration maxWait = {};
+    };
+
+private:
+    spdlog::logger m_logger;
+    std::mutex m_mutex;
+    bool m_stopped;
+    Lane m_interactive;
+    Lane m_background;
+    Scheduler::TimerId m_metricsTimer;
+
+private:
+    /// @brief Start worker threads
+    BlockingPool();
+
+    ~BlockingPool();
+
+    static inline BlockingPool& Instance()
+    {
+        static BlockingPool instance;
+        return instance;
+    }
+
+private:
+    /// @brief Get lane of priority
+    /// @param priority Priority of the lane
+    /// @return The lane
+    Lane& lane(Priority priority);
+
+    /// @brief Start lane's worker threads
+    /// @param lane The lane
+    /// @param workers Count of threads to start
+    void startLane(Lane& lane, size_t workers);
+
+    /// @brief Worker thread implementation
+    /// @param lane Lane the thread runs tasks of
+    void threadFunction(Lane& lane);
+
+    /// @brief Reject new tasks, discard waiting ones and wait for running ones to finish
+    void stop();
+
+    /// @brief Log metrics, reset them and schedule the next report
+    void reportMetrics();
+
+    /// @brief Log lane's metrics and reset them. Must be called with the mutex locked.
+    /// @param lane The lane
+    /// @param name Lane name for the log
+    void reportLaneMetrics(Lane& lane, const char* name);
+
+    /// @brief Queue task under key. Must be called with the mutex locked.
+    /// @param lane Lane to queue the task to
+    /// @param key Key to queue the task under
+    /// @param task The task to run: moved from only if accepted, so rejected one is destroyed unlocked
+    /// @param bounded Whether the task is rejected when the lane's limits are reached
+    /// @return True if the task was accepted
+    bool enqueue(Lane& lane, uint64_t key, Task& task, bool bounded);
+
+    /// @brief Get lane's current metrics. Must be called with the mutex locked.
+    /// @param lane The lane
+    /// @return Current metrics
+    static Metrics LaneMetrics(const Lane& lane);
+
+public:
+    /// @brief Run interactive task on a pool thread, unless the pool is overloaded
+    /// @param key Key to queue the task under, tasks of different keys take turns
+    /// @param task The task to run
+    /// @return True if the task was accepted, false if it was rejected because too many tasks are waiting
+    static bool Submit(uint64_t key, Task task);
+
+    /// @brief Run background task on a pool thread, unless too many background tasks are waiting
+    /// @param key Key to queue the task under, tasks of different keys take turns
+    /// @param task The task to run
+    /// @return True if the task was accepted, false if it was rejected because too many tasks are waiting
+    static bool Defer(uint64_t key, Task task);
+
+    /// @brief Run background task on a pool thread even if too many tasks are waiting. Meant for tasks nobody could retry.
+    /// @param key Key to queue the task under, tasks of different keys take turns
+    /// @param task The task to run
+    /// @return True if the task was accepted, false if the pool is stopped
+    static bool Post(uint64_t key, Task task);
+
+    /// @brief Get current metrics
+    /// @param priority Priority of tasks to get metrics of
+    /// @return Current metrics
+    static Metrics GetMetrics(Priority priority = Priority::Interactive);
+
+    /// @brief Reject new tasks, discard waiting ones and wait for running ones to finish.
+    /// Must not be called from a pool thread.
+    static void Stop();
+};
+
+} // namespace kb
@@ -0,0 +1,155 @@
+#pragma once
+
+// STL modules
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <fstream>
+
+// Library spdlog
+#include <spdlog/spdlog.h>
+
+// Custom modules
+#include "core/range_set.hpp"
+
+namespace kb {
+
+namespace CacheConst
+{
+    constexpr const char* IndexFile = "index.json";     // Cache index file name
+    constexpr const char* FileExtension = ".audio";     // Extension of cached audio files
+    constexpr const char* PartExtension = ".part";      // Extension of audio files being downloaded
+    constexpr const char* SpoolPrefix = "kontrabot-";   // Prefix of part files spooled to temporary directory when caching is disabled
+
+    namespace Fields
+    {
+        constexpr const char* Entries = "entries";
+        constexpr const char* Id = "id";
+        constexpr const char* Size = "size";
+    }
+}
+
+class Cache
+{
+public:
+    /*
+    *   File being downloaded, possibly in pieces.
+    *   It is spooled to the cache directory, or to temporary directory if caching is disabled.
+    */
+    class PartFile
+    {
+    private:
+        std::string m_videoId;
+        std::string m_path;
+        std::fstream m_file;
+        RangeSet m_ranges;
+
+    public:
+        /// @brief Create empty part file for video's audio
+        /// @param videoId ID of video to write
+        PartFile(const std::string& videoId);
+
+        ~PartFile();
+
+    public:
+        /// @brief Write data to the file
+        /// @param position Position in the file to write to
+        /// @param data Data to write
+        /// @param length Count of bytes to write
+        /// @return True if written successfully
+        bool write(uint64_t position, const uint8_t* data, size_t length);
+
+        /// @brief Read data written to the file before
+        /// @param position Position in the file to read from
+        /// @param data Buffer to read data to
+        /// @param length Max count of bytes to read
+        /// @return Count of bytes read: 0 if [position] wasn't written yet
+        size_t read(uint64_t position, uint8_t* data, size_t length);
+
+        /// @brief Check if the file is complete and can be added to cache
+        /// @param fileSize Size of complete file in bytes
+        /// @return True if commit() would add the file to cache
+        bool committable(uint64_t fileSize) const;
+
+        /// @brief Add the file to cache if it is complete. The file stays readable.
+        /// @param fileSize Size of complete file in bytes
+        void commit(uint64_t fileSize);
+
+    public:
+        /// @brief Get written ranges of the file
+        /// @return Written ranges
+        inline const RangeSet& ranges() const
+        {
+            return m_ranges;
+        }
+
+        /// @brief Check if the file can still be used
+        /// @return True if no error occurred
+        inline bool good() const
+        {
+            return static_cast<bool>(m_file);
+        }
+    };
+
+private:
+    struct Entry
+    {
+        uint64_t size;
+        std::list<std::string>::iterator order;
+    };
+
+private:
+    std::mutex m_mutex;
+    spdlog::logger m_logger;
+    std::string m_directory;
+    uint64_t m_maxSize;
+    uint64_t m_size;
+    std::list<std::string> m_order;
+    std::unordered_map<std::string, Entry> m_entries;
+    bool m_indexDirty;
+
+private:
+    /// @brief Load cache index and reconcile it with cache directory contents
+    Cache();
+
+    /// @brief Save cache index if lookups changed it since it was last saved
+    ~Cache();
+
+    static inline Cache& Instance()
+    {
+        static Cache instance;
+        return instance;
+    }
+
+private:
+    /// @brief Get path of cached video's audio file
+    /// @param videoId ID of video
+    /// @return Path of cached audio file
+    std::string filePath(const std::string& videoId) const;
+
+    /// @brief Atomically save cache index. Must be called with the mutex locked.
+    void saveIndex();
+
+    /// @brief Delete least recently used files until cache fits max size
+    void evict();
+
+    /// @brief Add downloaded file to cache
+    /// @param videoId ID of downloaded video
+    /// @param partPath Path of downloaded file
+    /// @param size Size of downloaded file in bytes
+    /// @return Path of cached file: empty if it couldn't be added
+    std::string insert(const std::string& videoId, const std::string& partPath, uint64_t size);
+
+public:
+    /// @brief Check if cache is enabled
+    /// @return True if cache is enabled
+    static bool Enabled();
+
+    /// @brief Look up video's audio file in cache
+    /// @param videoId ID of video to look up
+    /// @return Path of cached audio file: empty if video is not cached
+    static std::string Lookup(const std::string& videoId);
+};
+
+} // namespace kb
@@ -19,6 +19,12 @@ private:
     bool m_youtubeAuthEnabled = false;
     bool m_proxyEnabled = false;
     std::string m_proxyUrl;
+    size_t m_downloaderLookBehind;
+    size_t m_downloaderLookAhead;
+    uint64_t m_playerLowWatermark;
+    uint64_t m_playerHighWatermark;
+    std::string m_cacheDirectory;
+    uint64_t m_cacheMaxSize;
 
 private:
     Config();
@@ -53,6 +59,36 @@ public:
         std::lock_guard lock(Instance().m_mutex);
         return Instance().m_proxyUrl;
     }
+
+    static inline size_t DownloaderLookBehind() {
+        std::lock_guard lock(Instance().m_mutex);
+        return Instance().m_downloaderLookBehind;
+    }
+
+    static inline size_t DownloaderLookAhead() {
+        std::lock_guard lock(Instance().m_mutex);
+        return Instance().m_downloaderLookAhead;
+    }
+
+    static inline uint64_t PlayerLowWatermark() {
+        std::lock_guard lock(Instance().m_mutex);
+        return Instance().m_playerLowWatermark;
+    }
+
+    static inline uint64_t PlayerHighWatermark() {
+        std::lock_guard lock(Instance().m_mutex);
+        return Instance().m_playerHighWatermark;
+    }
+
+    static inline const std::string& CacheDirectory() {
+        std::lock_guard lock(Instance().m_mutex);
+        return Instance().m_cacheDirectory;
+    }
+
+    static inline uint64_t CacheMaxSize() {
+        std::lock_guard lock(Instance().m_mutex);
+        return Instance().m_cacheMaxSize;
+    }
 };
 
 } // namespace kb
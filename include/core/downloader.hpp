@@ -3,10 +3,13 @@
 #include <dpp/dpp.h>
 
 // STL modules
+#include <algorithm>
 #include <string>
 #include <vector>
+#include <deque>
+#include <memory>
+#include <fstream>
 #include <mutex>
-#include <thread>
 #include <condition_variable>
 
 extern "C" {
@@ -16,15 +19,49 @@ extern "C" {
     #include <libswresample/swresample.h>
 }
 
+// Library Curl
+#include <curl/curl.h>
+
+// Library Opus
+#include <opus/opus.h>
+
 // Library spdlog
 #include <spdlog/spdlog.h>
 
+// Custom modules
+#include "core/cache.hpp"
+#include "core/frame_pool.hpp"
+#include "core/ring_buffer.hpp"
+#include "core/stopwatch.hpp"
+#include "core/transfer_engine.hpp"
+
 namespace kb {
 
 namespace DownloaderConst
 {
     constexpr int MaxExtractionAttempts = 5;    // Maximum count of extraction attempts
     constexpr int MaxRequestAttempts = 5;       // Maximum count of request attempts
+    constexpr size_t MinLookAhead = 65536;      // Minimum size of download window ahead of read position
+    constexpr size_t ReadableSize = 32768;      // Bytes that must be downloaded ahead of read position for reading not to wait
+    constexpr uint64_t CommitPoolKey = 2;       // Blocking pool key of part file commits, no guild has such a small ID
+
+    /*
+    *   Containers served by YouTube describe their audio stream in the header,
+    *   so stream info is only probed, in a short window, when the header doesn't.
+    */
+    constexpr int64_t MaxProbeSize = 32768;             // Bytes read to detect container and streams
+    constexpr int64_t MaxAnalyzeDuration = 500000;      // Microseconds of packets analyzed when the header lacks stream info
+
+    /*
+    *   Audio is downloaded in range requests of adaptive size, because long ranges get throttled.
+    *   When chunks download too slowly compared to playback speed, they get smaller and more of them are downloaded at once.
+    */
+    constexpr uint64_t MinChunkSize = 262144;           // Minimum size of downloaded chunk
+    constexpr uint64_t InitialChunkSize = 2097152;      // Size of the first downloaded chunk
+    constexpr uint64_t MaxChunkSize = 10485760;         // Maximum size of downloaded chunk
+    constexpr int MaxParallelChunks = 4;                // Maximum count of chunks downloaded at once
+    constexpr int MinSpeedRatio = 4;                    // Chunks downloaded slower than this multiple of playback speed count as throttled
+    constexpr uint64_t ParallelAhead = 33554432;        // How far ahead of read position chunks are downloaded in parallel
 
     /*
         *  Size of audio frame for DPP. If the frame is smaller, the rest is filled with silence.
@@ -34,14 +71,22 @@ namespace DownloaderConst
 
     // Output PCM data properties
     constexpr AVChannelLayout OutputChannelLayout = AV_CHANNEL_LAYOUT_STEREO;
-    constexpr AVSampleFormat OutputFormat = AV_SAMPLE_FMT_S16P;
+    constexpr AVSampleFormat OutputFormat = AV_SAMPLE_FMT_S16;
     constexpr int OutputSampleRate = 48000;
+    constexpr int OutputSampleSize = 4;         // Size of one interleaved stereo 16 bit sample in bytes
+
+    // Opus passthrough properties
+    constexpr int OpusFrameDuration = 20;       // Duration of Opus packets sent to Discord in milliseconds
+    constexpr int OpusFrameSamples = 960;       // Count of samples per channel in one Opus packet sent to Discord
+    constexpr int MaxOpusPacketSize = 10208;    // Max size of repacketized Opus packet in bytes (8 frames of 1276 bytes)
+
+    static_assert(FrameSize <= FramePoolConst::BufferSize && MaxOpusPacketSize <= FramePoolConst::BufferSize, "Frames must fit pooled buffers");
 }
 
 class Downloader
 {
 private:
-    enum class ThreadStatus
+    enum class TransferStatus
     {
         Idle,
         Running,
@@ -50,20 +95,76 @@ private:
     };
 
 public:
-    class Frame : public std::vector<uint8_t>
+    // Audio frame in a pooled buffer: the buffer is returned to the pool when the frame is destroyed
+    class Frame
     {
     private:
+        FramePool::Buffer m_data;
+        size_t m_size;
         int64_t m_timestamp;
+        int m_duration;
 
     public:
         /// @brief Create empty frame
         Frame();
 
+        Frame(Frame&& other) noexcept;
+        Frame& operator=(Frame&& other) noexcept;
+        ~Frame();
+
     public:
         /// @brief Clear frame
         void clear();
 
+        /// @brief Replace frame data
+        /// @param data Data to copy
+        /// @param size Count of bytes to copy
+        /// @return False if the data doesn't fit capacity(): the frame is left unchanged
+        bool assign(const uint8_t* data, size_t size);
+
+        /// @brief Change count of bytes in the frame. Added bytes are not initialized.
+        /// @param size New count of bytes: at most capacity()
+        inline void resize(size_t size)
+        {
+            m_size = std::min(size, capacity());
+        }
+
     public:
+        /// @brief Get frame data
+        /// @return Frame data
+        inline uint8_t* data()
+        {
+            return m_data.get();
+        }
+
+        /// @brief Get frame data
+        /// @return Frame data
+        inline const uint8_t* data() const
+        {
+            return m_data.get();
+        }
+
+        /// @brief Get count of bytes in the frame
+        /// @return Count of bytes in the frame
+        inline size_t size() const
+        {
+            return m_size;
+        }
+
+        /// @brief Get max count of bytes the frame can hold
+        /// @return Frame capacity
+        static constexpr size_t capacity()
+        {
+            return FramePoolConst::BufferSize;
+        }
+
+        /// @brief Check if the frame is empty
+        /// @return True if the frame has no data
+        inline bool empty() const
+        {
+            return m_size == 0;
+        }
+
         /// @brief Get frame timestamp
         /// @return Frame timestamp in milliseconds
         inline int64_t timestamp() const
@@ -79,18 +180,63 @@ public:
                 timestamp = -1;
             m_timestamp = timestamp;
         }
+
+        /// @brief Get frame duration
+        /// @return Frame duration in milliseconds: only set for Opus frames
+        inline int duration() const
+        {
+            return m_duration;
+        }
+
+        /// @brief Set frame duration
+        /// @param duration Frame duration in milliseconds
+        inline void setDuration(int duration)
+        {
+            m_duration = duration;
+        }
     };
 
 private:
-    /// @brief Curl progress callback
-    /// @param target Downloader target
-    /// @param downloadTotal Count of downloaded bytes
-    /// @param downloadNow Count of total bytes to download
-    /// @param uploadTotal Count of uploaded bytes
-    /// @param uploadNow Count of total bytes to upload
-    /// @return 1 if download should be terminated, 0 otherwise
-    static int ProgressCallback(Downloader* target, double downloadTotal, double downloadNow, double uploadTotal, double uploadNow);
+    // Chunk downloaded in parallel with the main transfer, straight to the part file
+    struct ChunkTransfer
+    {
+        Downloader* downloader;
+        std::unique_ptr<CURL, decltype(&TransferEngine::Release)> curl;
+        uint64_t start;
+        uint64_t position;
+        uint64_t end;
+        bool running;
+        Stopwatch stopwatch;
+
+        /// @brief Create idle chunk transfer
+        /// @param downloader Downloader the chunk belongs to
+        ChunkTransfer(Downloader* downloader);
+    };
+
+    // Complete part file added to cache on the blocking pool, away from the transfer engine thread
+    struct PartFileCommit
+    {
+        Downloader* downloader;
+        std::unique_ptr<Cache::PartFile> partFile;
+        uint64_t fileSize;
+
+        /// @brief Take part file from downloader
+        /// @param downloader Downloader the part file belongs to
+        /// @param partFile The complete part file
+        /// @param fileSize Size of complete file in bytes
+        PartFileCommit(Downloader* downloader, std::unique_ptr<Cache::PartFile> partFile, uint64_t fileSize);
 
+        /// @brief Give part file back to downloader if the commit was discarded without running
+        ~PartFileCommit();
+
+        /// @brief Add part file to cache and give it back to downloader
+        void run();
+
+        /// @brief Give part file back to downloader: it stays readable, from cache if it was committed
+        void giveBack();
+    };
+
+private:
     /// @brief Curl header writer callback
     /// @param data Data to write
     /// @param itemSize Size of one item in bytes
@@ -104,9 +250,17 @@ private:
     /// @param itemSize Size of one item in bytes
     /// @param itemCount Count of items
     /// @param target Target to write data to
-    /// @return Count of written bytes
+    /// @return Count of written bytes: CURL_WRITEFUNC_PAUSE if the window is full
     static size_t DownloaderWriter(uint8_t* data, size_t itemSize, size_t itemCount, Downloader* target);
 
+    /// @brief Curl chunk writer callback
+    /// @param data Data to write
+    /// @param itemSize Size of one item in bytes
+    /// @param itemCount Count of items
+    /// @param target Chunk to write data to
+    /// @return Count of written bytes
+    static size_t ChunkWriter(uint8_t* data, size_t itemSize, size_t itemCount, ChunkTransfer* target);
+
     /// @brief FFmpeg data read callback
     /// @param root Downloader to read data from
     /// @param buffer Buffer to read data to
@@ -125,24 +279,58 @@ public:
     spdlog::logger m_logger;
     std::string m_videoId;
     std::string m_audioUrl;
+    std::string m_container;
+    uint64_t m_bitrate;
     uint64_t m_fileSize;
 
     std::mutex m_mutex;
-    std::thread m_thread;
-    ThreadStatus m_threadStatus;
+    std::unique_ptr<CURL, decltype(&TransferEngine::Release)> m_curl;
+    bool m_firstChunk;
+    TransferStatus m_transferStatus;
+    bool m_transferPaused;
+    bool m_transferWasPaused;
+    uint64_t m_transferStart;
+    uint64_t m_transferEnd;
+    Stopwatch m_transferStopwatch;
+    uint64_t m_chunkSize;
+    int m_parallelism;
+    std::vector<std::unique_ptr<ChunkTransfer>> m_chunkTransfers;
+    int m_requestAttempt;
+    int m_downloadAttempt;
     std::condition_variable m_cv;
-    std::vector<uint8_t> m_buffer;
+    size_t m_lookBehind;
+    size_t m_lookAhead;
+    RingBuffer m_window;
+    uint64_t m_windowOffset;
     uint64_t m_position;
-    uint64_t m_positionOffset;
+    std::ifstream m_cacheFile;
+    std::unique_ptr<Cache::PartFile> m_partFile;
+    bool m_partFileCommitting;
 
     AVIOContext* m_io;
     AVFormatContext* m_format;
     AVStream* m_stream;
     AVCodecContext* m_codec;
     SwrContext* m_resampler;
+    AVChannelLayout m_resamplerLayout;
+    AVSampleFormat m_resamplerFormat;
+    int m_resamplerSampleRate;
     int m_unitsPerSecond;
     int64_t m_seekPosition;
-    Frame m_overflowFrame;
+    AVPacket* m_packet;
+    AVFrame* m_decodedFrame;
+    uint8_t** m_samples;
+    int m_samplesCapacity;
+    int m_samplesCount;
+    int m_samplesRead;
+    int64_t m_samplesTimestamp;
+    bool m_resamplerFlushed;
+
+    OpusRepacketizer* m_repacketizer;
+    std::vector<Frame> m_splitOpusFrames;
+    std::vector<Frame> m_pendingOpusFrames;
+    int m_pendingOpusSamples;
+    std::deque<Frame> m_opusPackets;
 
 public:
     /// @brief Initialize audio extractor
@@ -156,18 +344,131 @@ public:
     ~Downloader();
 
 private:
-    /// @brief Download thread implementation
+    /// @brief Get position of the end of downloaded window
+    /// @return Absolute byte position after the last downloaded byte
+    inline uint64_t windowEnd() const
+    {
+        return m_windowOffset + m_window.size();
+    }
+
+    /// @brief Check if started transfer delivered its first bytes or ended. Must be called with the mutex locked.
+    /// @return True if waiting for the transfer is over
+    inline bool transferStarted() const
+    {
+        return m_transferStatus != TransferStatus::Running || windowEnd() > m_transferStart;
+    }
+
+    /// @brief Configure Curl handle of a transfer
+    /// @param curl Handle to configure
+    /// @param target Write callback target
+    /// @param writeFunction Write callback
+    /// @throw std::runtime_error if internal error occurs
+    template<typename Target>
+    void configureTransfer(CURL* curl, Target* target, size_t (*writeFunction)(uint8_t*, size_t, size_t, Target*));
+
+    /// @brief Drop window bytes that are further behind read position than look-behind allows
+    void trimWindow();
+
+    /// @brief Resume paused transfer if the window has enough free space
+    void resumeTransfer();
+
+    /// @brief Handle finished transfer: called on transfer engine thread
+    /// @param result Curl result code of the transfer
+    void transferDone(CURLcode result);
+
+    /// @brief Get the first position that isn't downloaded nor being downloaded
+    /// @param position Position to look up from
+    /// @return The first missing position at or after [position]
+    uint64_t nextMissing(uint64_t position) const;
+
+    /// @brief Check if position is being downloaded by a parallel chunk
+    /// @param position Position to check
+    /// @return True if a running chunk will download [position]
+    bool chunkFetching(uint64_t position) const;
+
+    /// @brief Adapt chunk size and parallelism to measured download speed
+    /// @param bytes Count of downloaded bytes
+    /// @param seconds Download duration in seconds
+    void adaptChunks(uint64_t bytes, float seconds);
+
+    /// @brief Start parallel chunk downloads ahead of the main transfer. Must be called with the mutex locked.
+    void scheduleChunks();
+
+    /// @brief Handle finished chunk: called on transfer engine thread
+    /// @param chunk The finished chunk
+    /// @param result Curl result code of the chunk transfer
+    void chunkDone(ChunkTransfer& chunk, CURLcode result);
+
+    /// @brief Hand part file to the blocking pool to be added to cache if it is complete. Must be called with the mutex locked.
+    void commitPartFile();
+
+    /// @brief Continue transfer at the first byte after the window that wasn't downloaded yet. Must be called with the mutex locked.
+    /// @return False if there is nothing left to download
+    bool continueTransfer();
+
+    /// @brief Cancel transfer and start it again at another position
+    /// @param lock Lock of the mutex: unlocked while the transfer is being cancelled
     /// @param startPosition Byte position to start download from
-    void threadFunction(uint64_t startPosition);
+    void restartTransfer(std::unique_lock<std::mutex>& lock, uint64_t startPosition);
 
-    /// @brief Start download thread
+    /// @brief Start transfer on transfer engine. Must be called with the mutex locked.
     /// @param startPosition Byte position to start download from
-    void startThread(uint64_t startPosition = 0);
+    void startTransfer(uint64_t startPosition = 0);
 
-    /// @brief Stop download thread
-    void stopThread();
+    /// @brief Cancel transfer and wait until its callbacks and part file commit aren't running
+    void stopTransfer();
+
+    /// @brief Read next packet of the audio stream to m_packet
+    /// @return False if there are no more packets
+    bool readPacket();
+
+    /// @brief Make samples buffer hold at least sample count
+    /// @param sampleCount Count of samples per channel
+    /// @throw std::runtime_error if internal error occurs
+    void reserveSamples(int sampleCount);
+
+    /// @brief Create resampler for decoded frame's format, replacing current one. Samples it delays are dropped.
+    /// @param frame Decoded frame
+    /// @throw std::runtime_error if resampler couldn't be created
+    void configureResampler(const AVFrame& frame);
+
+    /// @brief Get samples delayed by the resampler to m_samples at the end of stream
+    /// @throw std::runtime_error if internal error occurs
+    /// @return False if there were no delayed samples
+    bool flushResampler();
+
+    /// @brief Decode and convert next audio frame to m_samples
+    /// @throw std::runtime_error if internal error occurs
+    /// @return False if all frames were decoded
+    bool decodeSamples();
+
+    /// @brief Merge pending short Opus frames into packets ready to be sent
+    /// @return Opus error code: OPUS_OK if merged successfully
+    int flushOpusFrames();
+
+    /// @brief Split or merge Opus packet into packets of Discord frame duration
+    /// @param packet The packet to repacketize
+    /// @param timestamp Packet timestamp in milliseconds
+    /// @return Opus error code: OPUS_OK if repacketized successfully
+    int repacketize(const AVPacket& packet, int64_t timestamp);
+
+    /// @brief Extract next Opus packet without decoding it
+    /// @throw std::runtime_error if internal error occurs
+    /// @return Opus frame: empty if all packets were extracted
+    Frame extractOpusFrame();
 
 public:
+    /// @brief Check if Opus packets are passed through without decoding
+    /// @return True if frames contain Opus packets, false if they contain PCM data
+    inline bool passthrough() const
+    {
+        return m_repacketizer != nullptr;
+    }
+
+    /// @brief Check if extracting next frame won't wait for the download
+    /// @return True if enough bytes ahead of read position are downloaded or reading would fail right away
+    bool readable();
+
     /// @brief Seek audio track
     /// @param timestamp Timestamp to seek to in seconds
     void seekTo(int64_t timestamp);
@@ -0,0 +1,123 @@
+#pragma once
+
+// STL modules
+#include <chrono>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Library spdlog
+#include <spdlog/spdlog.h>
+
+// Custom modules
+#include "core/scheduler.hpp"
+
+namespace kb {
+
+namespace FormatCacheConst
+{
+    constexpr size_t MaxFormats = 1024;                         // Count of audio formats kept in memory, least recently used ones are resolved again
+    constexpr std::chrono::hours DefaultLifetime(5);            // Lifetime of audio URLs without an expiration parameter
+    constexpr std::chrono::minutes MinRemainingLifetime(30);    // Audio URLs expiring sooner are resolved again before use
+    constexpr std::chrono::minutes RefreshMargin(60);           // Time before expiration at which audio URLs are refreshed
+    constexpr std::chrono::hours RefreshIdleLimit(2);           // Audio URLs unused for this long are evicted instead of refreshed
+    constexpr std::chrono::minutes RefreshRetryDelay(1);        // Time after which refresh rejected by busy blocking pool is tried again
+    constexpr uint64_t RefreshPoolKey = 0;                      // Blocking pool key of background refreshes, no guild has such a small ID
+}
+
+/*
+*   Shared cache of signed audio URLs.
+*   Concurrent requests for the same video wait for one request to YouTube,
+*   and URLs still in use are refreshed before they expire.
+*/
+class FormatCache
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct AudioFormat
+    {
+        std::string url;                        // Signed URL of the audio stream
+        uint64_t bitrate;                       // Bitrate of the audio stream in bits per second
+        Clock::time_point expiration;           // Time after which the URL stops working
+        std::string container;                  // Short name of the container, e.g. "webm": empty if unknown
+    };
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const AudioFormat> format;
+        Clock::time_point lastUse;
+        Scheduler::TimerId refreshTimer;
+        std::list<std::string>::iterator usage;
+    };
+
+private:
+    spdlog::logger m_logger;
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::list<std::string> m_usage;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const AudioFormat>>> m_pendingFormats;
+
+private:
+    FormatCache();
+
+    static inline FormatCache& Instance()
+    {
+        static FormatCache instance;
+        return instance;
+    }
+
+private:
+    /// @brief Find usable audio format and mark it as used. Must be called with the mutex locked.
+    /// @param videoId ID of video
+    /// @return Cached audio format or nullptr if it isn't cached or expires soon
+    std::shared_ptr<const AudioFormat> find(const std::string& videoId);
+
+    /// @brief Cache audio format, evicting least recently used ones, and schedule its refresh. Must be called with the mutex locked.
+    /// @param videoId ID of video
+    /// @param format The audio format
+    void insert(const std::string& videoId, std::shared_ptr<const AudioFormat> format);
+
+    /// @brief Remove cached audio format and cancel its refresh. Must be called with the mutex locked.
+    /// @param entry Iterator to the entry
+    void erase(std::unordered_map<std::string, Entry>::iterator entry);
+
+    /// @brief Get audio format, resolving it or joining a running resolution
+    /// @param videoId ID of video
+    /// @param refresh Resolve even if the cached format is usable
+    /// @throw std::runtime_error if the format can't be resolved
+    /// @return The audio format
+    std::shared_ptr<const AudioFormat> get(const std::string& videoId, bool refresh);
+
+    /// @brief Refresh audio format if it was used recently, otherwise evict it
+    /// @param videoId ID of video
+    void refresh(const std::string& videoId);
+
+    /// @brief Resolve best audio format of video
+    /// @param videoId ID of video
+    /// @throw std::runtime_error if the video has no audio formats
+    /// @return The audio format
+    static std::shared_ptr<const AudioFormat> Resolve(const std::string& videoId);
+
+public:
+    /// @brief Get audio format of video, resolving it if it isn't cached or expires soon
+    /// @param videoId ID of video
+    /// @throw std::runtime_error if the format can't be resolved
+    /// @return The audio format
+    static std::shared_ptr<const AudioFormat> Get(const std::string& videoId);
+
+    /// @brief Resolve audio format of video in background, so playing it doesn't wait for YouTube
+    /// @param videoId ID of video
+    /// @param key Blocking pool key to queue the resolution under: prefetches of one guild take turns with other guilds
+    static void Prefetch(const std::string& videoId, uint64_t key);
+
+    /// @brief Forget audio format of video, e.g. because its URL stopped working
+    /// @param videoId ID of video
+    static void Invalidate(const std::string& videoId);
+};
+
+} // namespace kb
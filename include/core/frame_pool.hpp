@@ -0,0 +1,45 @@
+#pragma once
+
+// STL modules
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace kb {
+
+namespace FramePoolConst
+{
+    constexpr size_t BufferSize = 11520;        // Size of pooled buffers: fits 60 ms PCM frame for DPP and any Opus packet
+    constexpr size_t MaxIdleBuffers = 64;       // Maximum count of returned buffers kept for reuse
+}
+
+class FramePool
+{
+public:
+    using Buffer = std::unique_ptr<uint8_t[]>;
+
+private:
+    std::mutex m_mutex;
+    std::vector<Buffer> m_buffers;
+
+private:
+    FramePool();
+
+    static inline FramePool& Instance()
+    {
+        static FramePool instance;
+        return instance;
+    }
+
+public:
+    /// @brief Get buffer of FramePoolConst::BufferSize bytes
+    /// @return Returned buffer if there is any, new buffer otherwise
+    static Buffer Acquire();
+
+    /// @brief Return buffer for reuse
+    /// @param buffer Buffer got from Acquire()
+    static void Release(Buffer buffer);
+};
+
+} // namespace kb
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 namespace kb {
@@ -8,6 +9,25 @@ namespace IO {
     void WriteFile(const std::string& fileName, const std::string& contents);
 
     std::string ReadFile(const std::string& fileName);
+
+    /*
+    *   Descriptor-level file access for writes that must reach the disk.
+    *   Functions return false or -1 on error, descriptors are POSIX or CRT ones.
+    */
+    int OpenForWriting(const std::string& fileName, bool append);
+
+    int64_t FileSize(int descriptor);
+
+    bool WriteAll(int descriptor, const std::string& data);
+
+    bool SyncFile(int descriptor);
+
+    bool TruncateFile(int descriptor, uint64_t size);
+
+    void CloseFile(int descriptor);
+
+    // Makes creations and renames inside file's directory durable. Windows has no such call, it does nothing there.
+    void SyncDirectory(const std::string& fileName);
 }
 
 } // namespace kb
@@ -0,0 +1,64 @@
+#pragma once
+
+// STL modules
+#include <cstdint>
+#include <limits>
+#include <map>
+
+namespace kb {
+
+class RangeSet
+{
+public:
+    static constexpr uint64_t End = std::numeric_limits<uint64_t>::max();
+
+private:
+    std::map<uint64_t, uint64_t> m_ranges;  // Disjoint, non-adjacent ranges: start -> end (exclusive)
+    uint64_t m_size;
+
+public:
+    /// @brief Create empty range set
+    RangeSet();
+
+public:
+    /// @brief Add range to the set, merging it with overlapping and adjacent ranges
+    /// @param start First position of the range
+    /// @param end Position after the last one of the range
+    void insert(uint64_t start, uint64_t end);
+
+    /// @brief Remove all ranges from the set
+    void clear();
+
+    /// @brief Get end of the range containing position
+    /// @param position Position to look up
+    /// @return End of the range containing [position]: [position] itself if no range contains it
+    uint64_t rangeEnd(uint64_t position) const;
+
+    /// @brief Get start of the first range after position
+    /// @param position Position to look up from
+    /// @return Start of the first range starting after [position]: RangeSet::End if there is none
+    uint64_t nextStart(uint64_t position) const;
+
+    /// @brief Check if single range contains whole interval
+    /// @param start First position of the interval
+    /// @param end Position after the last one of the interval
+    /// @return True if all positions of the interval are in the set
+    bool covers(uint64_t start, uint64_t end) const;
+
+public:
+    /// @brief Get count of positions in the set
+    /// @return Total length of all ranges
+    inline uint64_t size() const
+    {
+        return m_size;
+    }
+
+    /// @brief Check if the set is empty
+    /// @return True if the set has no ranges
+    inline bool empty() const
+    {
+        return m_ranges.empty();
+    }
+};
+
+} // namespace kb
@@ -0,0 +1,75 @@
+#pragma once
+
+// STL modules
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+
+namespace kb {
+
+class RingBuffer
+{
+private:
+    std::unique_ptr<uint8_t[]> m_data;
+    size_t m_capacity;
+    size_t m_head;
+    size_t m_size;
+
+public:
+    /// @brief Create ring buffer
+    /// @param capacity Max count of bytes the buffer can hold
+    RingBuffer(size_t capacity);
+
+public:
+    /// @brief Append bytes to the end of the buffer
+    /// @param data Bytes to append
+    /// @param length Count of bytes to append
+    /// @return Count of bytes appended: less than [length] if the buffer got full
+    size_t push(const uint8_t* data, size_t length);
+
+    /// @brief Copy bytes from the buffer without removing them
+    /// @param offset Offset from the beginning of the buffer to copy from
+    /// @param buffer Buffer to copy bytes to
+    /// @param length Count of bytes to copy
+    /// @return Count of bytes copied
+    size_t peek(size_t offset, uint8_t* buffer, size_t length) const;
+
+    /// @brief Remove bytes from the beginning of the buffer
+    /// @param length Count of bytes to remove
+    /// @return Count of bytes removed
+    size_t discard(size_t length);
+
+    /// @brief Remove all bytes from the buffer
+    void clear();
+
+public:
+    /// @brief Get count of stored bytes
+    /// @return Count of stored bytes
+    inline size_t size() const
+    {
+        return m_size;
+    }
+
+    /// @brief Get max count of bytes the buffer can hold
+    /// @return Buffer capacity
+    inline size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    /// @brief Get count of bytes that can be appended
+    /// @return Count of free bytes
+    inline size_t free() const
+    {
+        return m_capacity - m_size;
+    }
+
+    /// @brief Check if the buffer is empty
+    /// @return True if the buffer is empty
+    inline bool empty() const
+    {
+        return m_size == 0;
+    }
+};
+
+} // namespace kb
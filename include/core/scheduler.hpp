@@ -0,0 +1,104 @@
+#pragma once
+
+// STL modules
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Library spdlog
+#include <spdlog/spdlog.h>
+
+// Custom modules
+#include "core/timer_wheel.hpp"
+
+namespace kb {
+
+namespace SchedulerConst
+{
+    constexpr size_t MinWorkers = 2;            // Count of workers started when there are fewer cores
+}
+
+class Scheduler
+{
+public:
+    using Clock = TimerWheel::Clock;
+
+    // Function executed on a worker thread: must not block for long
+    using Task = std::function<void()>;
+
+    // Scheduled task identifier: 0 is never used
+    using TimerId = TimerWheel::TimerId;
+
+private:
+    struct Worker
+    {
+        size_t index = 0;
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+private:
+    static thread_local Worker* CurrentWorker;
+
+private:
+    spdlog::logger m_logger;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_nextWorker;
+    std::atomic<size_t> m_queuedTasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopped;
+
+private:
+    /// @brief Start one worker thread per core
+    Scheduler();
+
+    ~Scheduler();
+
+    static inline Scheduler& Instance()
+    {
+        static Scheduler instance;
+        return instance;
+    }
+
+private:
+    /// @brief Worker thread implementation
+    /// @param worker The worker running the thread
+    void threadFunction(Worker* worker);
+
+    /// @brief Add task to worker's queue and wake up an idle worker
+    /// @param worker The worker to give the task to
+    /// @param task The task to add
+    void push(Worker& worker, Task task);
+
+    /// @brief Take task from worker's queue or steal it from other workers
+    /// @param worker The worker looking for a task
+    /// @param task Taken task
+    /// @return True if a task was taken
+    bool pop(Worker& worker, Task& task);
+
+public:
+    /// @brief Run task as soon as a worker is free. Tasks posted from a worker run on it unless stolen.
+    /// @param task The task to run
+    static void Post(Task task);
+
+    /// @brief Run task after delay
+    /// @param task The task to run
+    /// @param delay Time to wait before running the task
+    /// @return Identifier to cancel the task with
+    static TimerId Schedule(Task task, Clock::duration delay);
+
+    /// @brief Cancel scheduled task
+    /// @param timerId Identifier returned by Schedule()
+    /// @return True if the task was cancelled, false if it's already running or finished
+    static bool Cancel(TimerId timerId);
+};
+
+} // namespace kb
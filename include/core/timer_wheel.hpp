@@ -0,0 +1,124 @@
+#pragma once
+
+// STL modules
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace kb {
+
+namespace TimerWheelConst
+{
+    constexpr std::chrono::milliseconds TickDuration(10);   // Timer resolution
+    constexpr int RootBits = 8;                             // Finest level has 2^8 slots of one tick
+    constexpr int LevelBits = 6;                            // Every coarser level has 2^6 slots
+    constexpr int LevelCount = 4;                           // Levels cover 2^26 ticks (about 7.7 days), longer timers are cascaded again
+    constexpr uint64_t RootSlots = uint64_t(1) << RootBits;
+    constexpr uint64_t LevelSlots = uint64_t(1) << LevelBits;
+}
+
+class TimerWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Function called on wheel thread when timer expires: must not block
+    using Callback = std::function<void()>;
+
+    // Timer identifier: 0 is never used
+    using TimerId = uint64_t;
+
+private:
+    using Slot = std::list<TimerId>;
+
+    struct Timer
+    {
+        Callback callback;
+        uint64_t expiry;
+        Slot* slot;                 // nullptr if the timer expired and waits for its callback to run
+        Slot::iterator position;
+    };
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_callbackCv;
+    std::thread m_thread;
+    bool m_stopped;
+    Clock::time_point m_startTime;
+    uint64_t m_tick;
+    TimerId m_lastTimerId;
+    TimerId m_runningTimer;
+    std::unordered_map<TimerId, Timer> m_timers;
+    std::array<std::vector<Slot>, TimerWheelConst::LevelCount> m_levels;
+    std::vector<TimerId> m_expired;
+
+private:
+    /// @brief Start wheel thread
+    TimerWheel();
+
+    ~TimerWheel();
+
+    static inline TimerWheel& Instance()
+    {
+        static TimerWheel instance;
+        return instance;
+    }
+
+private:
+    /// @brief Wheel thread implementation
+    void threadFunction();
+
+    /// @brief Get tick at time point
+    /// @param time The time point
+    /// @param roundUp Whether to round partial tick up or down
+    /// @return Count of ticks since wheel start
+    uint64_t tickAt(Clock::time_point time, bool roundUp) const;
+
+    /// @brief Put timer to the slot of its expiry. Must be called with the mutex locked.
+    /// @param timerId ID of the timer
+    /// @param timer The timer
+    void insert(TimerId timerId, Timer& timer);
+
+    /// @brief Take timer out of its slot. Must be called with the mutex locked.
+    /// @param timer The timer
+    void unlink(Timer& timer);
+
+    /// @brief Advance wheel by one tick, cascading coarser levels and collecting expired timers. Must be called with the mutex locked.
+    void advance();
+
+    /// @brief Get the earliest tick something may happen at. Must be called with the mutex locked.
+    /// @return Tick of the next non-empty finest slot or the next cascade
+    uint64_t nextEventTick() const;
+
+    /// @brief Call callbacks of expired timers
+    /// @param lock Acquired mutex lock: released while callbacks run
+    void runExpired(std::unique_lock<std::mutex>& lock);
+
+public:
+    /// @brief Start timer
+    /// @param callback Function to call when the timer expires
+    /// @param delay Time until the timer expires
+    /// @return Identifier to reset or cancel the timer with
+    static TimerId Arm(Callback callback, Clock::duration delay);
+
+    /// @brief Restart timer with new delay
+    /// @param timerId Identifier returned by Arm()
+    /// @param delay Time from now until the timer expires
+    /// @return True if the timer was restarted, false if it has already expired
+    static bool Reset(TimerId timerId, Clock::duration delay);
+
+    /// @brief Cancel timer. Its callback isn't running after this function returns, unless it's called from the callback itself.
+    /// @param timerId Identifier returned by Arm()
+    /// @return True if the timer was cancelled, false if it has already expired
+    static bool Cancel(TimerId timerId);
+};
+
+} // namespace kb
@@ -0,0 +1,119 @@
+#pragma once
+
+// STL modules
+#include <array>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Library Curl
+#include <curl/curl.h>
+
+// Library spdlog
+#include <spdlog/spdlog.h>
+
+namespace kb {
+
+namespace TransferEngineConst
+{
+    constexpr size_t MaxIdleHandles = 8;        // Maximum count of released easy handles kept for reuse
+    constexpr long MaxConnections = 16;         // Maximum count of idle connections kept alive
+    constexpr long DnsCacheTimeout = 600;       // Time in seconds resolved host names are kept
+}
+
+class TransferEngine
+{
+public:
+    // Function called on engine thread when transfer is finished
+    using DoneCallback = std::function<void(CURLcode result)>;
+
+private:
+    // Function executed on engine thread
+    using Command = std::function<void()>;
+
+private:
+    spdlog::logger m_logger;
+    CURLM* m_multi;
+    CURLSH* m_share;
+    std::array<std::mutex, CURL_LOCK_DATA_LAST> m_shareMutexes;
+    std::vector<CURL*> m_idleHandles;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::vector<Command> m_commands;
+    bool m_stopped;
+    std::map<CURL*, DoneCallback> m_transfers;
+    std::map<CURL*, DoneCallback> m_failedTransfers;
+
+private:
+    /// @brief Start engine thread
+    /// @throw std::runtime_error if internal error occurs
+    TransferEngine();
+
+    ~TransferEngine();
+
+    static inline TransferEngine& Instance()
+    {
+        static TransferEngine instance;
+        return instance;
+    }
+
+private:
+    /// @brief Curl share lock callback
+    /// @param handle Easy handle using the share
+    /// @param data Type of shared data to lock
+    /// @param access Type of access to the data
+    /// @param engine Engine owning the share
+    static void LockShare(CURL* handle, curl_lock_data data, curl_lock_access access, TransferEngine* engine);
+
+    /// @brief Curl share unlock callback
+    /// @param handle Easy handle using the share
+    /// @param data Type of shared data to unlock
+    /// @param engine Engine owning the share
+    static void UnlockShare(CURL* handle, curl_lock_data data, TransferEngine* engine);
+
+private:
+    /// @brief Engine thread implementation
+    void threadFunction();
+
+    /// @brief Execute command on engine thread
+    /// @param command The command to execute
+    void post(Command command);
+
+    /// @brief Execute command on engine thread and wait for it to finish
+    /// @param command The command to execute
+    void execute(const Command& command);
+
+    /// @brief Remove transfer from multi handle or cancel its pending failure
+    /// @param easy Transfer's easy handle
+    void removeTransfer(CURL* easy);
+
+    /// @brief Report failure of transfer that couldn't be added, unless it was removed since
+    /// @param easy Transfer's easy handle
+    void failTransfer(CURL* easy);
+
+public:
+    /// @brief Get easy handle sharing DNS cache, TLS sessions and connections with other transfers
+    /// @return Easy handle with default options: nullptr if it couldn't be created
+    static CURL* Acquire();
+
+    /// @brief Return easy handle for reuse. Its transfer must not be running.
+    /// @param easy Easy handle got from Acquire()
+    static void Release(CURL* easy);
+
+    /// @brief Start transfer
+    /// @param easy Configured easy handle of the transfer
+    /// @param done Function to call when transfer is finished: may start the same transfer again
+    static void Add(CURL* easy, DoneCallback done);
+
+    /// @brief Resume transfer paused by its write function
+    /// @param easy Transfer's easy handle
+    static void Resume(CURL* easy);
+
+    /// @brief Cancel transfer. No transfer callbacks are called after this function returns.
+    /// @param easy Transfer's easy handle
+    static void Remove(CURL* easy);
+};
+
+} // namespace kb
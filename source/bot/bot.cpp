@@ -6,7 +6,13 @@
 // Custom modules
 #include "bot/locale/locales.hpp"
 #include "bot/commands.hpp"
+#include "bot/info_cache.hpp"
+#include "bot/item_cache.hpp"
+#include "core/blocking_pool.hpp"
 #include "core/config.hpp"
+#include "core/format_cache.hpp"
+#include "core/scheduler.hpp"
+#include "core/stopwatch.hpp"
 #include "core/utility.hpp"
 
 #include <ytcpp/utility.hpp>
@@ -64,83 +70,150 @@ Bot::Bot::Bot(bool registerCommands)
     on_voice_track_marker(std::bind(&Bot::onVoiceTrackMarker, this, std::placeholders::_1));
 }
 
-void Bot::Bot::presenceFunction()
+Bot::Bot::~Bot()
 {
-    enum class PresenceType
     {
-        GuildsServed,
-        SessionsConducted,
-        TracksPlayed,
-        MaxPresenceTypes,
-    };
+        // Presence update that already fired is waited for, it would use the destroyed bot otherwise
+        std::unique_lock lock(m_presenceMutex);
+        m_presenceStopped = true;
+        if (m_presenceTimer && Scheduler::Cancel(m_presenceTimer))
+            m_presenceTimer = 0;
+        m_presenceCv.wait(lock, [this]() { return !m_presenceTimer && !m_presenceRunning; });
+    }
+
+    // Events must stop arriving before the state they use is torn down
+    shutdown();
+
+    // Interactions, downloader opens and disconnects running on the pool use the bot and its players
+    BlockingPool::Stop();
+
+    // Info is saved before anything else can go wrong while players are torn down
+    InfoCache::Flush();
+
+    std::map<dpp::snowflake, Player> players;
+    {
+        std::lock_guard lock(m_playersMutex);
+        players.swap(m_players);
+    }
+    players.clear();
+}
+
+void Bot::Bot::schedulePresence(Scheduler::Clock::duration delay)
+{
+    if (!m_presenceStopped)
+        m_presenceTimer = Scheduler::Schedule([this]() { updatePresence(); }, delay);
+}
 
-    for (PresenceType type = PresenceType::GuildsServed; true; type = static_cast<PresenceType>(static_cast<int>(type) + 1))
+void Bot::Bot::updatePresence()
+{
     {
-        if (type == PresenceType::MaxPresenceTypes)
-            type = PresenceType::GuildsServed;
+        std::lock_guard lock(m_presenceMutex);
+        m_presenceTimer = 0;
+        if (m_presenceStopped)
+        {
+            m_presenceCv.notify_all();
+            return;
+        }
+        m_presenceRunning = true;
+    }
 
-        switch (type)
+    switch (m_presenceType)
+    {
+        case PresenceType::GuildsServed:
         {
-            case PresenceType::GuildsServed:
+            current_application_get([this](const dpp::confirmation_callback_t& event)
             {
-                current_application_get([this](const dpp::confirmation_callback_t& event)
+                if (event.is_error())
                 {
-                    if (event.is_error())
-                    {
-                        m_logger.error("Couldn't get current application for presence update");
-                        return;
-                    }
-
-                    const dpp::application& application = std::get<dpp::application>(event.value);
-                    set_presence(dpp::presence(dpp::ps_online, dpp::at_custom, fmt::format(
-                        "{} guild{} served",
-                        Utility::NiceString(application.approximate_guild_count),
-                        LocaleEn::Cardinal(application.approximate_guild_count)
-                    )));
-                });
-                break;
-            }
-            case PresenceType::SessionsConducted:
-            {
-                Stats globalStats = Info::GetGlobalStats();
-                set_presence(dpp::presence(dpp::ps_online, dpp::at_custom, fmt::format(
-                    "{} session{} conducted",
-                    Utility::NiceString(globalStats.sessionsConducted),
-                    LocaleEn::Cardinal(globalStats.sessionsConducted)
-                )));
-                break;
-            }
-            case PresenceType::TracksPlayed:
-            {
-                Stats globalStats = Info::GetGlobalStats();
+                    m_logger.error("Couldn't get current application for presence update");
+                    return;
+                }
+
+                const dpp::application& application = std::get<dpp::application>(event.value);
                 set_presence(dpp::presence(dpp::ps_online, dpp::at_custom, fmt::format(
-                    "{} track{} played",
-                    Utility::NiceString(globalStats.tracksPlayed),
-                    LocaleEn::Cardinal(globalStats.tracksPlayed)
+                    "{} guild{} served",
+                    Utility::NiceString(application.approximate_guild_count),
+                    LocaleEn::Cardinal(application.approximate_guild_count)
                 )));
-                break;
-            }
+            });
+            break;
+        }
+        case PresenceType::SessionsConducted:
+        {
+            Stats globalStats = Info::GetGlobalStats();
+            set_presence(dpp::presence(dpp::ps_online, dpp::at_custom, fmt::format(
+                "{} session{} conducted",
+                Utility::NiceString(globalStats.sessionsConducted),
+                LocaleEn::Cardinal(globalStats.sessionsConducted)
+            )));
+            break;
         }
+        case PresenceType::TracksPlayed:
+        {
+            Stats globalStats = Info::GetGlobalStats();
+            set_presence(dpp::presence(dpp::ps_online, dpp::at_custom, fmt::format(
+                "{} track{} played",
+                Utility::NiceString(globalStats.tracksPlayed),
+                LocaleEn::Cardinal(globalStats.tracksPlayed)
+            )));
+            break;
+        }
+    }
+
+    m_presenceType = static_cast<PresenceType>(static_cast<int>(m_presenceType) + 1);
+    if (m_presenceType == PresenceType::MaxPresenceTypes)
+        m_presenceType = PresenceType::GuildsServed;
 
-        pt::time_duration toNextMinute = Utility::TimeToNextMinute();
-        if (toNextMinute.total_seconds() < 10)
-            toNextMinute += pt::minutes(1);
-        Utility::Sleep(toNextMinute.total_milliseconds() / 1000.0);
+    pt::time_duration toNextMinute = Utility::TimeToNextMinute();
+    if (toNextMinute.total_seconds() < 10)
+        toNextMinute += pt::minutes(1);
+
+    std::lock_guard lock(m_presenceMutex);
+    m_presenceRunning = false;
+    schedulePresence(std::chrono::milliseconds(toNextMinute.total_milliseconds()));
+    m_presenceCv.notify_all();
+}
+
+Bot::Bot::PlayerEntry Bot::Bot::findPlayer(dpp::snowflake guildId)
+{
+    std::lock_guard lock(m_playersMutex);
+    return m_players.find(guildId);
+}
+
+void Bot::Bot::erasePlayer(dpp::snowflake guildId)
+{
+    // Player is destroyed outside of the map lock: it waits for its playback to stop
+    std::map<dpp::snowflake, Player>::node_type playerNode;
+    {
+        std::lock_guard lock(m_playersMutex);
+        playerNode = m_players.extract(guildId);
     }
 }
 
+std::string Bot::Bot::takeEphemeralToken(dpp::snowflake messageId)
+{
+    std::lock_guard lock(m_ephemeralTokensMutex);
+    auto ephemeralTokenEntry = m_ephemeralTokens.find(messageId);
+    if (ephemeralTokenEntry == m_ephemeralTokens.end())
+        return {};
+
+    std::string token = std::move(ephemeralTokenEntry->second);
+    m_ephemeralTokens.erase(ephemeralTokenEntry);
+    return token;
+}
+
 void Bot::Bot::updateEphemeralToken(const dpp::confirmation_callback_t& confirmationEvent, std::string token)
 {
     if (!confirmationEvent.is_error())
     {
-        std::lock_guard lock(m_mutex);
+        std::lock_guard lock(m_ephemeralTokensMutex);
         m_ephemeralTokens[confirmationEvent.get<dpp::message>().id] = token;
     }
 }
 
 Bot::Bot::PlayerEntry Bot::Bot::updatePlayerTextChannelId(dpp::snowflake guildId, dpp::snowflake channelId)
 {
-    PlayerEntry player = m_players.find(guildId);
+    PlayerEntry player = findPlayer(guildId);
     if (player != m_players.end())
         player->second.updateTextChannel(channelId);
     return player;
@@ -155,7 +228,7 @@ Bot::Info Bot::Bot::updateInfoProcessedInteractions(dpp::snowflake guildId)
 
 bool Bot::Bot::playerControlsLocked(const dpp::guild& guild, dpp::snowflake userId)
 {
-    PlayerEntry playerEntry = m_players.find(guild.id);
+    PlayerEntry playerEntry = findPlayer(guild.id);
     if (playerEntry == m_players.end())
     {
         // There is no playerEntry to lock when bot is not sitting in any voice channel
@@ -170,7 +243,7 @@ bool Bot::Bot::playerControlsLocked(const dpp::guild& guild, dpp::snowflake user
     }
 
     // Player controls are locked for all users that are not sitting in the same voice channel with bot
-    return playerEntry->second.session().voiceChannelId != voiceMemberEntry->second.channel_id;
+    return playerEntry->second.voiceChannelId() != voiceMemberEntry->second.channel_id;
 }
 
 Bot::Bot::JoinStatus Bot::Bot::joinUserVoice(dpp::discord_client* client, const dpp::interaction& interaction, Info& info, const ytcpp::Item& item)
@@ -194,13 +267,17 @@ Bot::Bot::JoinStatus Bot::Bot::joinUserVoice(dpp::discord_client* client, const
     }
 
     guild->connect_member_voice(user.id, false, true);
-    auto emplacedPlayerEntry = m_players.emplace(
-        std::piecewise_construct,
-        std::forward_as_tuple(guild->id),
-        std::forward_as_tuple(this, client, interaction, userVoice->id, info)
-    );
+    PlayerEntry playerEntry;
+    {
+        std::lock_guard lock(m_playersMutex);
+        playerEntry = m_players.emplace(
+            std::piecewise_construct,
+            std::forward_as_tuple(guild->id),
+            std::forward_as_tuple(this, client, interaction, userVoice->id, info)
+        ).first;
+    }
     if (item)
-        emplacedPlayerEntry.first->second.addItem(item, user, info);
+        playerEntry->second.addItem(item, user, info);
     return { JoinStatus::Result::Joined, userVoice };
 }
 
@@ -211,10 +288,16 @@ dpp::message Bot::Bot::addItem(dpp::discord_client* client, const dpp::interacti
 
     try
     {
-        if (!ytcpp::Utility::GetVideoId(itemId).empty())
+        Stopwatch resolveStopwatch;
+        const std::string videoId = ytcpp::Utility::GetVideoId(itemId);
+        if (!videoId.empty())
         {
-            ytcpp::Video video(itemId);
-            std::lock_guard lock(m_mutex);
+            // Audio URL is resolved while metadata is
+            FormatCache::Prefetch(videoId, guild.id);
+            std::shared_ptr<const ytcpp::Item> item = ItemCache::Get(ytcpp::Item::Type::Video, videoId);
+            const float resolveMilliseconds = resolveStopwatch.milliseconds();
+            const ytcpp::Video& video = std::get<ytcpp::Video>(*item);
+            std::lock_guard lock(guildMutex(guild.id));
             Info info(guild.id);
 
             if (video.isLivestream()) {
@@ -226,12 +309,12 @@ dpp::message Bot::Bot::addItem(dpp::discord_client* client, const dpp::interacti
                 return info.settings().locale->cantPlayPremieres();
             }
 
-            JoinStatus joinStatus = joinUserVoice(client, interaction, info, video);
-            PlayerEntry playerEntry = m_players.find(guild.id);
+            JoinStatus joinStatus = joinUserVoice(client, interaction, info, *item);
+            PlayerEntry playerEntry = findPlayer(guild.id);
             switch (joinStatus.result)
             {
                 case JoinStatus::Result::AlreadyJoined:
-                    playerEntry->second.addItem(video, requester, info);
+                    playerEntry->second.addItem(*item, requester, info);
                     break;
                 case JoinStatus::Result::UserNotInVoiceChannel:
                     m_logger.info(logMessage("User not in voice channel"));
@@ -243,24 +326,30 @@ dpp::message Bot::Bot::addItem(dpp::discord_client* client, const dpp::interacti
                     break;
             }
 
-            m_logger.info(logMessage(fmt::format("Added \"{}\" [{}]", video.title(), Utility::NiceString(video.duration()))));
-            return info.settings().locale->itemAdded(video, playerEntry->second.paused(), showRequester ? interaction.get_issuing_user() : std::optional<dpp::user>{});
+            m_logger.info(logMessage(fmt::format(
+                "Added \"{}\" [{}], resolved in {:.0f} ms",
+                video.title(), Utility::NiceString(video.duration()), resolveMilliseconds
+            )));
+            return info.settings().locale->itemAdded(*item, playerEntry->second.paused(), showRequester ? interaction.get_issuing_user() : std::optional<dpp::user>{});
         }
 
-        ytcpp::Playlist playlist(itemId);
-        std::lock_guard lock(m_mutex);
+        const std::string playlistId = ytcpp::Utility::GetPlaylistId(itemId);
+        std::shared_ptr<const ytcpp::Item> item = ItemCache::Get(ytcpp::Item::Type::Playlist, playlistId.empty() ? itemId : playlistId);
+        const ytcpp::Playlist& playlist = std::get<ytcpp::Playlist>(*item);
+        const float resolveMilliseconds = resolveStopwatch.milliseconds();
+        std::lock_guard lock(guildMutex(guild.id));
         Info info(guild.id);
         if (playlist.empty()) {
             m_logger.info(logMessage("Empty playlists can't be played"));
             return info.settings().locale->cantPlayEmptyPlaylists();
         }
 
-        JoinStatus joinStatus = joinUserVoice(client, interaction, info, playlist);
-        PlayerEntry playerEntry = m_players.find(guild.id);
+        JoinStatus joinStatus = joinUserVoice(client, interaction, info, *item);
+        PlayerEntry playerEntry = findPlayer(guild.id);
         switch (joinStatus.result)
         {
             case JoinStatus::Result::AlreadyJoined:
-                playerEntry->second.addItem(playlist, requester, info);
+                playerEntry->second.addItem(*item, requester, info);
                 break;
             case JoinStatus::Result::UserNotInVoiceChannel:
                 m_logger.info(logMessage("User not in voice channel"));
@@ -272,50 +361,60 @@ dpp::message Bot::Bot::addItem(dpp::discord_client* client, const dpp::interacti
                 break;
         }
 
-        m_logger.info(logMessage(fmt::format("Added \"{}\" [{} videos]", playlist.title(), Utility::NiceString(playlist.videoCount()))));
-        return info.settings().locale->itemAdded(playlist, playerEntry->second.paused(), showRequester ? interaction.get_issuing_user() : std::optional<dpp::user>{});
+        m_logger.info(logMessage(fmt::format(
+            "Added \"{}\" [{} videos], resolved in {:.0f} ms",
+            playlist.title(), Utility::NiceString(playlist.videoCount()), resolveMilliseconds
+        )));
+        return info.settings().locale->itemAdded(*item, playerEntry->second.paused(), showRequester ? interaction.get_issuing_user() : std::optional<dpp::user>{});
     }
     catch (const ytcpp::YtError& error)
     {
-        std::lock_guard lock(m_mutex);
         m_logger.error(logMessage(fmt::format("YouTube error: {}", error.what())));
         return Info(guild.id).settings().locale->youtubeError(error);
     }
     catch (const ytcpp::Error& error)
     {
-        std::lock_guard lock(m_mutex);
         m_logger.error(logMessage(fmt::format("ytcpp error: {}", error.what())));
         return Info(guild.id).settings().locale->unknownError();
     }
     catch (const std::runtime_error& error)
     {
-        std::lock_guard lock(m_mutex);
         m_logger.error(logMessage(fmt::format("Runtime error: {}", error.what())));
         return Info(guild.id).settings().locale->unknownError();
     }
     catch (const std::exception& error)
     {
-        std::lock_guard lock(m_mutex);
         m_logger.error(logMessage(fmt::format("Unknown error: {}", error.what())));
         return Info(guild.id).settings().locale->unknownError();
     }
     catch (...)
     {
-        std::lock_guard lock(m_mutex);
         m_logger.error(logMessage("Unknown error"));
         return Info(guild.id).settings().locale->unknownError();
     }
 }
 
-Bot::Bot::LeaveStatus Bot::Bot::leaveVoice(dpp::discord_client* client, const dpp::guild& guild, Info& info, Locale::EndReason reason)
+std::mutex& Bot::Bot::guildMutex(dpp::snowflake guildId)
+{
+    // Lowest snowflake bits are worker and sequence numbers, the timestamp spreads guilds better
+    return m_guildMutexes[(guildId >> 22) % BotConst::GuildLockShards];
+}
+
+Bot::Bot::LeaveStatus Bot::Bot::leaveVoice(dpp::discord_client* client, const dpp::guild& guild, Info& info, Locale::EndReason reason, uint64_t sessionNumber)
 {
     dpp::voiceconn* botVoice = client->get_voice(guild.id);
     if (!botVoice)
         return { LeaveStatus::Result::BotNotInVoiceChannel };
 
+    PlayerEntry playerEntry = findPlayer(guild.id);
+    if (playerEntry == m_players.end())
+        return { LeaveStatus::Result::BotNotInVoiceChannel };
+    if (sessionNumber && playerEntry->second.sessionNumber() != sessionNumber)
+        return { LeaveStatus::Result::BotNotInVoiceChannel };
+
     const dpp::channel* disconnectedChannel = dpp::find_channel(botVoice->channel_id);
-    m_players.find(guild.id)->second.endSession(info, reason);
-    m_players.erase(guild.id);
+    playerEntry->second.endSession(info, reason);
+    erasePlayer(guild.id);
     return { LeaveStatus::Result::Left, disconnectedChannel };
 }
 
@@ -23,14 +23,14 @@ void Bot::Bot::onAutocomplete(const dpp::autocomplete_t& event)
         );
     };
 
-    std::lock_guard lock(m_mutex);
+    std::lock_guard lock(guildMutex(guild.id));
     updateInfoProcessedInteractions(guild.id);
 
     const dpp::command_option& option = event.options[0];
     if (option.name == CommandsConst::Seek::TimestampChapter::Name)
     {
         value = std::get<std::string>(option.value);        
-        PlayerEntry playerEntry = m_players.find(guild.id);
+        PlayerEntry playerEntry = findPlayer(guild.id);
         if (playerEntry == m_players.end())
         {
             interaction_response_create(event.command.id, event.command.token, dpp::interaction_response(dpp::ir_autocomplete_reply));
@@ -38,8 +38,8 @@ void Bot::Bot::onAutocomplete(const dpp::autocomplete_t& event)
             return;
         }
 
-        Session session = playerEntry->second.session();
-        if (!session.playingVideo)
+        std::shared_ptr<const Session> session = playerEntry->second.session();
+        if (!session->playingVideo)
         {
             interaction_response_create(event.command.id, event.command.token, dpp::interaction_response(dpp::ir_autocomplete_reply));
             m_logger.info(logMessage("Nothing is playing"));
@@ -48,13 +48,13 @@ void Bot::Bot::onAutocomplete(const dpp::autocomplete_t& event)
 
         // Temporarily unsupported!
         interaction_response_create(event.command.id, event.command.token, dpp::interaction_response(dpp::ir_autocomplete_reply));
-        m_logger.info(logMessage(fmt::format("Chapters are temporarily unsupported", session.playingVideo->video.title())));
+        m_logger.info(logMessage(fmt::format("Chapters are temporarily unsupported", session->playingVideo->video.title())));
         return;
         /* Temporarily unsupported!
-        if (session.playingVideo->video.chapters().empty())
+        if (session->playingVideo->video.chapters().empty())
         {
             interaction_response_create(event.command.id, event.command.token, dpp::interaction_response(dpp::ir_autocomplete_reply));
-            m_logger.info(logMessage(fmt::format("Video \"{}\" has no chapters", session.playingVideo->video.title())));
+            m_logger.info(logMessage(fmt::format("Video \"{}\" has no chapters", session->playingVideo->video.title())));
             return;
         }
         
@@ -62,9 +62,9 @@ void Bot::Bot::onAutocomplete(const dpp::autocomplete_t& event)
         if (value.empty() || value.find_first_not_of(' ') == std::string::npos)
         {
             dpp::interaction_response response(dpp::ir_autocomplete_reply);
-            for (size_t index = 0, size = session.playingVideo->video.chapters().size(); index < size && index < 25; ++index)
+            for (size_t index = 0, size = session->playingVideo->video.chapters().size(); index < size && index < 25; ++index)
             {
-                const Youtube::Video::Chapter& chapter = session.playingVideo->video.chapters()[index];
+                const Youtube::Video::Chapter& chapter = session->playingVideo->video.chapters()[index];
                 std::string firstPart = fmt::format("{}: ", chapter.number);
                 std::string secondPart = fmt::format(" [{}]", Utility::NiceString(chapter.timestamp));
                 response.add_autocomplete_choice(dpp::command_option_choice(fmt::format(
@@ -81,9 +81,9 @@ void Bot::Bot::onAutocomplete(const dpp::autocomplete_t& event)
         }
 
         dpp::interaction_response response(dpp::ir_autocomplete_reply);
-        for (size_t index = 0, size = session.playingVideo->video.chapters().size(); index < size && response.autocomplete_choices.size() < 25; ++index)
+        for (size_t index = 0, size = session->playingVideo->video.chapters().size(); index < size && response.autocomplete_choices.size() < 25; ++index)
         {
-            const Youtube::Video::Chapter& chapter = session.playingVideo->video.chapters()[index];
+            const Youtube::Video::Chapter& chapter = session->playingVideo->video.chapters()[index];
             if (Utility::CaseInsensitiveStringContains(chapter.name, value))
             {
                 std::string firstPart = fmt::format("{}: ", chapter.number);
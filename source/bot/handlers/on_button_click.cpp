@@ -2,6 +2,8 @@
 
 // Custom modules
 #include "bot/locale/locale_en.hpp"
+#include "bot/search_cache.hpp"
+#include "core/blocking_pool.hpp"
 
 namespace kb {
 
@@ -16,7 +18,7 @@ void Bot::Bot::onButtonClick(const dpp::button_click_t& event)
         );
     };
 
-    std::lock_guard lock(m_mutex);
+    std::lock_guard lock(guildMutex(guild.id));
     updatePlayerTextChannelId(guild.id, event.command.channel_id);
     Info info = updateInfoProcessedInteractions(guild.id);
 
@@ -33,42 +35,49 @@ void Bot::Bot::onButtonClick(const dpp::button_click_t& event)
                 return;
             }
 
-            std::thread([this, event, logMessage, signal]()
+            const bool submitted = BlockingPool::Submit(guild.id, [this, event, logMessage, signal]()
             {
                 event.thinking();
                 event.edit_original_response(addItem(event.from(), event.command, signal.data(), logMessage, true));
-            }).detach();
+            });
+            if (!submitted)
+            {
+                event.reply(info.settings().locale->busy());
+                m_logger.info(logMessage("Too busy"));
+            }
             break;
         }
         case Signal::Type::RelatedSearch:
         {
-            std::thread([this, event, guild, logMessage, signal]()
+            const bool submitted = BlockingPool::Submit(guild.id, [this, event, guildId = guild.id, logMessage, signal]()
             {
                 try
                 {
                     event.thinking(true);
-                    ytcpp::SearchResults results = ytcpp::RelatedSearch(signal.data());
-                    std::lock_guard lock(m_mutex);
-
+                    SearchCache::Results results = SearchCache::RelatedSearch(signal.data());
                     event.edit_original_response(
-                        Info(guild.id).settings().locale->search(results),
+                        Info(guildId).settings().locale->search(*results),
                         std::bind(&Bot::updateEphemeralToken, this, std::placeholders::_1, event.command.token)
                     );
                     m_logger.info(logMessage(fmt::format(
                         "Related for \"{}\": {} result{}",
-                        signal.data(), results.size(), LocaleEn::Cardinal(results.size())
+                        signal.data(), results->size(), LocaleEn::Cardinal(results->size())
                     )));
                 }
                 catch (const std::runtime_error& error)
                 {
-                    std::lock_guard lock(m_mutex);
-                    event.edit_original_response(Info(guild.id).settings().locale->unknownError());
+                    event.edit_original_response(Info(guildId).settings().locale->unknownError());
                     m_logger.error(logMessage(fmt::format(
                         "Related for \"{}\": Runtime error: {}",
                         signal.data(), error.what()
                     )));
                 }
-            }).detach();
+            });
+            if (!submitted)
+            {
+                event.reply(info.settings().locale->busy());
+                m_logger.info(logMessage("Too busy"));
+            }
             return;
         }
         case Signal::Type::Unsupported:
@@ -85,16 +94,15 @@ void Bot::Bot::onButtonClick(const dpp::button_click_t& event)
         }
     }
 
-    auto ephemeralTokenEntry = m_ephemeralTokens.find(event.command.msg.id);
-    if (ephemeralTokenEntry == m_ephemeralTokens.end())
+    std::string ephemeralToken = takeEphemeralToken(event.command.msg.id);
+    if (ephemeralToken.empty())
         return;
 
     dpp::message message = event.command.msg;
     for (dpp::component& component : message.components[0].components)
         component.disabled = true;
 
-    interaction_followup_edit(ephemeralTokenEntry->second, message);
-    m_ephemeralTokens.erase(event.command.msg.id);
+    interaction_followup_edit(ephemeralToken, message);
 }
 
 } // namespace kb
@@ -9,8 +9,11 @@ void Bot::Bot::onReady(const dpp::ready_t& event)
 {
     if (dpp::run_once<struct ReadyMessage>())
     {
-        // Start presence thread
-        m_presenceThread = std::thread(&Bot::presenceFunction, this);
+        // Presence keeps rescheduling itself
+        {
+            std::lock_guard lock(m_presenceMutex);
+            schedulePresence(Scheduler::Clock::duration::zero());
+        }
 
         global_commands_get([this](const dpp::confirmation_callback_t& event)
         {
@@ -1,5 +1,8 @@
 #include "bot/bot.hpp"
 
+// Custom modules
+#include "core/blocking_pool.hpp"
+
 namespace kb {
 
 void Bot::Bot::onSelectClick(const dpp::select_click_t& event)
@@ -14,7 +17,7 @@ void Bot::Bot::onSelectClick(const dpp::select_click_t& event)
         );
     };
 
-    std::lock_guard lock(m_mutex);
+    std::lock_guard lock(guildMutex(guild.id));
     Info info = updateInfoProcessedInteractions(guild.id);
 
     if (playerControlsLocked(guild, event.command.usr.id))
@@ -30,11 +33,16 @@ void Bot::Bot::onSelectClick(const dpp::select_click_t& event)
         case Signal::Type::PlayVideo:
         case Signal::Type::PlayPlaylist:
         {
-            std::thread([this, event, logMessage, signal]()
+            const bool submitted = BlockingPool::Submit(guild.id, [this, event, logMessage, signal]()
             {
                 event.thinking();
                 event.edit_original_response(addItem(event.from(), event.command, signal.data(), logMessage, true));
-            }).detach();
+            });
+            if (!submitted)
+            {
+                event.reply(info.settings().locale->busy());
+                m_logger.info(logMessage("Too busy"));
+            }
             break;
         }
         case Signal::Type::Unsupported:
@@ -51,7 +59,8 @@ void Bot::Bot::onSelectClick(const dpp::select_click_t& event)
         }
     }
 
-    if (m_ephemeralTokens.find(event.command.msg.id) != m_ephemeralTokens.end())
+    std::string ephemeralToken = takeEphemeralToken(event.command.msg.id);
+    if (!ephemeralToken.empty())
     {
         dpp::message message = event.command.msg;
         dpp::component& selectMenu = message.components[0].components[0];
@@ -65,8 +74,7 @@ void Bot::Bot::onSelectClick(const dpp::select_click_t& event)
         }
         selectMenu.disabled = true;
 
-        interaction_followup_edit(m_ephemeralTokens[message.id], message);
-        m_ephemeralTokens.erase(event.command.msg.id);
+        interaction_followup_edit(ephemeralToken, message);
     }
 }
 
@@ -9,6 +9,8 @@
 // Custom modules
 #include "bot/locale/locale_en.hpp"
 #include "bot/commands.hpp"
+#include "bot/search_cache.hpp"
+#include "core/blocking_pool.hpp"
 #include "core/utility.hpp"
 
 #include <ytcpp/utility.hpp>
@@ -73,7 +75,7 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
         );
     };
 
-    std::lock_guard lock(m_mutex);
+    std::lock_guard lock(guildMutex(guild.id));
     PlayerEntry playerEntry = updatePlayerTextChannelId(guild.id, event.command.channel_id);
     Info info = updateInfoProcessedInteractions(guild.id);
 
@@ -93,7 +95,7 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        event.reply(info.settings().locale->session(playerEntry->second.session()));
+        event.reply(info.settings().locale->session(*playerEntry->second.session()));
         m_logger.info(logMessage("Showing player's session"));
         return;
     }
@@ -202,9 +204,9 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
 
     if (interaction.name == CommandsConst::Leave::Name)
     {
-        std::optional<Session> session;
+        std::shared_ptr<const Session> session;
         if (playerEntry != m_players.end())
-            session.emplace(playerEntry->second.session());
+            session = playerEntry->second.session();
 
         LeaveStatus leaveStatus = leaveVoice(event.from(), guild, info, Locale::EndReason::UserRequested);
         switch (leaveStatus.result)
@@ -239,7 +241,7 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        std::thread([this, event, guild, logMessage, whatOption]()
+        const bool submitted = BlockingPool::Submit(guild.id, [this, event, guildId = guild.id, logMessage, whatOption]()
         {
             if (!ytcpp::Utility::GetVideoId(whatOption).empty() || !ytcpp::Utility::GetPlaylistId(whatOption).empty())
             {
@@ -251,22 +253,24 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             try
             {
                 event.thinking(true);
-                ytcpp::SearchResults results = ytcpp::QuerySearch(whatOption);
-                std::lock_guard lock(m_mutex);
-
+                SearchCache::Results results = SearchCache::QuerySearch(whatOption);
                 event.edit_original_response(
-                    Info(guild.id).settings().locale->search(results),
+                    Info(guildId).settings().locale->search(*results),
                     std::bind(&Bot::updateEphemeralToken, this, std::placeholders::_1, event.command.token)
                 );
-                m_logger.info(logMessage(fmt::format("{} result{}", results.size(), LocaleEn::Cardinal(results.size()))));
+                m_logger.info(logMessage(fmt::format("{} result{}", results->size(), LocaleEn::Cardinal(results->size()))));
             }
             catch (const std::runtime_error& error)
             {
-                std::lock_guard lock(m_mutex);
-                event.edit_original_response(Info(guild.id).settings().locale->unknownError());
+                event.edit_original_response(Info(guildId).settings().locale->unknownError());
                 m_logger.error(logMessage(fmt::format("Runtime error: {}", error.what())));
             }
-        }).detach();
+        });
+        if (!submitted)
+        {
+            event.reply(info.settings().locale->busy());
+            m_logger.info(logMessage("Too busy"));
+        }
         return;
     }
 
@@ -279,8 +283,8 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        Session session = playerEntry->second.session();
-        if (!session.playingVideo)
+        std::shared_ptr<const Session> session = playerEntry->second.session();
+        if (!session->playingVideo)
         {
             event.reply(info.settings().locale->nothingIsPlaying());
             m_logger.info(logMessage("Nothing is playing"));
@@ -288,12 +292,12 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
         }
 
         bool paused = playerEntry->second.pauseResume(info);
-        event.reply(info.settings().locale->paused(session.playingVideo->video, paused));
+        event.reply(info.settings().locale->paused(session->playingVideo->video, paused));
         m_logger.info(logMessage(fmt::format(
             "{} \"{}\" [{}]",
             paused ? "Paused" : "Resumed",
-            session.playingVideo->video.title(),
-            Utility::NiceString(session.playingVideo->video.duration())
+            session->playingVideo->video.title(),
+            Utility::NiceString(session->playingVideo->video.duration())
         )));
         return;
     }
@@ -307,8 +311,8 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        Session session = playerEntry->second.session();
-        if (!session.playingVideo)
+        std::shared_ptr<const Session> session = playerEntry->second.session();
+        if (!session->playingVideo)
         {
             event.reply(info.settings().locale->nothingIsPlaying());
             m_logger.info(logMessage("Nothing is playing"));
@@ -329,16 +333,16 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
                     std::stoi(matches.str(3)), 0
                 );
 
-                if (timestamp > session.playingVideo->video.duration())
+                if (timestamp > session->playingVideo->video.duration())
                 {
-                    event.reply(info.settings().locale->timestampOutOfBounds(session.playingVideo->video));
+                    event.reply(info.settings().locale->timestampOutOfBounds(session->playingVideo->video));
                     m_logger.info(logMessage("Seek timestamp is out of bounds"));
                     return;
                 }
 
                 playerEntry->second.seek(timestamp.total_seconds(), info);
-                event.reply(info.settings().locale->seeking(session.playingVideo->video, timestamp, playerEntry->second.paused()));
-                m_logger.info(logMessage(fmt::format("Seeking \"{}\" to {}", session.playingVideo->video.title(), Utility::NiceString(timestamp))));
+                event.reply(info.settings().locale->seeking(session->playingVideo->video, timestamp, playerEntry->second.paused()));
+                m_logger.info(logMessage(fmt::format("Seeking \"{}\" to {}", session->playingVideo->video.title(), Utility::NiceString(timestamp))));
                 return;
             }
             catch (const std::out_of_range&)
@@ -355,30 +359,30 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
         return;
 
         /* Temporarily unsupported!
-        if (session.playingVideo->video.chapters().empty())
+        if (session->playingVideo->video.chapters().empty())
         {
-            event.reply(info.settings().locale->noChapters(session.playingVideo->video));
-            m_logger.info(logMessage(fmt::format("Video \"{}\" has no chapters", session.playingVideo->video.title())));
+            event.reply(info.settings().locale->noChapters(session->playingVideo->video));
+            m_logger.info(logMessage(fmt::format("Video \"{}\" has no chapters", session->playingVideo->video.title())));
             return;
         }
 
-        for (const Youtube::Video::Chapter& chapter : session.playingVideo->video.chapters())
+        for (const Youtube::Video::Chapter& chapter : session->playingVideo->video.chapters())
         {
             if (timestampChapterOption == chapter.name)
             {
                 playerEntry->second.seek(chapter.timestamp.total_seconds(), info);
                 event.reply(info.settings().locale->seeking(
-                    session.playingVideo->video,
+                    session->playingVideo->video,
                     chapter,
                     playerEntry->second.paused()
                 ));
-                m_logger.info(logMessage(fmt::format("Seeking \"{}\" to {}", session.playingVideo->video.title(), Utility::NiceString(chapter.timestamp))));
+                m_logger.info(logMessage(fmt::format("Seeking \"{}\" to {}", session->playingVideo->video.title(), Utility::NiceString(chapter.timestamp))));
                 return;
             }
         }
 
-        event.reply(info.settings().locale->unknownChapter(session.playingVideo->video));
-        m_logger.info(logMessage(fmt::format("Video \"{}\" doesn't have such chapter", session.playingVideo->video.title())));
+        event.reply(info.settings().locale->unknownChapter(session->playingVideo->video));
+        m_logger.info(logMessage(fmt::format("Video \"{}\" doesn't have such chapter", session->playingVideo->video.title())));
         return;
         */
 
@@ -394,7 +398,7 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        size_t itemCount = playerEntry->second.session().queue.size();
+        size_t itemCount = playerEntry->second.session()->queue.size();
         switch (itemCount)
         {
             case 0:
@@ -422,8 +426,8 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        Session session = playerEntry->second.session();
-        if (!session.playingVideo)
+        std::shared_ptr<const Session> session = playerEntry->second.session();
+        if (!session->playingVideo)
         {
             event.reply(info.settings().locale->nothingIsPlaying());
             m_logger.info(logMessage("Not playing"));
@@ -434,14 +438,14 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
         if (subcommand == CommandsConst::Skip::Video::Name)
         {
             playerEntry->second.skipVideo(info);
-            event.reply(info.settings().locale->skipped(session.playingVideo->video, playerEntry->second.paused()));
-            m_logger.info(logMessage(fmt::format("Skipped video \"{}\"", session.playingVideo->video.title())));
+            event.reply(info.settings().locale->skipped(session->playingVideo->video, playerEntry->second.paused()));
+            m_logger.info(logMessage(fmt::format("Skipped video \"{}\"", session->playingVideo->video.title())));
             return;
         }
 
         if (subcommand == CommandsConst::Skip::Playlist::Name)
         {
-            if (!session.playingPlaylist)
+            if (!session->playingPlaylist)
             {
                 event.reply(info.settings().locale->noPlaylistIsPlaying());
                 m_logger.info(logMessage("No playlist is playing"));
@@ -449,8 +453,8 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             }
 
             playerEntry->second.skipPlaylist(info);
-            event.reply(info.settings().locale->skipped(session.playingPlaylist->playlist, playerEntry->second.paused()));
-            m_logger.info(logMessage(fmt::format("Skipped playlist \"{}\"", session.playingPlaylist->playlist.title())));
+            event.reply(info.settings().locale->skipped(session->playingPlaylist->playlist, playerEntry->second.paused()));
+            m_logger.info(logMessage(fmt::format("Skipped playlist \"{}\"", session->playingPlaylist->playlist.title())));
             return;
         }
 
@@ -468,15 +472,15 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        Session session = playerEntry->second.session();
-        if (!session.playingVideo)
+        std::shared_ptr<const Session> session = playerEntry->second.session();
+        if (!session->playingVideo)
         {
             event.reply(info.settings().locale->nothingIsPlaying());
             m_logger.info(logMessage("Nothing is playing"));
             return;
         }
 
-        if (session.queue.empty())
+        if (session->queue.empty())
         {
             event.reply(info.settings().locale->queueIsEmpty());
             m_logger.info(logMessage("Queue is empty"));
@@ -498,8 +502,8 @@ void Bot::Bot::onSlashcommand(const dpp::slashcommand_t& event)
             return;
         }
 
-        Session session = playerEntry->second.session();
-        if (!session.playingVideo)
+        std::shared_ptr<const Session> session = playerEntry->second.session();
+        if (!session->playingVideo)
         {
             event.reply(info.settings().locale->nothingIsPlaying());
             m_logger.info(logMessage("Nothing is playing"));
@@ -4,9 +4,9 @@ namespace kb {
 
 void Bot::Bot::onVoiceReady(const dpp::voice_ready_t& event)
 {
-    std::lock_guard lock(m_mutex);
+    std::lock_guard lock(guildMutex(event.voice_client->server_id));
     Info info = updateInfoProcessedInteractions(event.voice_client->server_id);
-    m_players.find(event.voice_client->server_id)->second.signalReady(info);
+    findPlayer(event.voice_client->server_id)->second.signalReady(info);
     m_logger.info("\"{}\": Voice client is ready", dpp::find_guild(event.voice_client->server_id)->name);
 }
 
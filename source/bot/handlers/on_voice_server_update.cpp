@@ -14,15 +14,15 @@ void Bot::Bot::onVoiceServerUpdate(const dpp::voice_server_update_t& event)
 
     std::string playerEndpoint;
     {
-        std::lock_guard lock(m_mutex);
-        PlayerEntry playerEntry = m_players.find(event.guild_id);
+        std::lock_guard lock(guildMutex(event.guild_id));
+        PlayerEntry playerEntry = findPlayer(event.guild_id);
         if (playerEntry == m_players.end())
         {
             m_logger.warn(logMessage("Voice server update event received from guild with no player"));
             return;
         }
 
-        playerEndpoint = playerEntry->second.session().voiceServerEndpoint;
+        playerEndpoint = playerEntry->second.session()->voiceServerEndpoint;
         if (playerEndpoint.empty())
         {
             playerEntry->second.updateVoiceServerEndpoint(event.endpoint);
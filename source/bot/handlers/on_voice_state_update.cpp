@@ -7,7 +7,7 @@ void Bot::Bot::onVoiceStateUpdate(const dpp::voice_state_update_t& event)
     dpp::guild* guild = dpp::find_guild(event.state.guild_id);
     dpp::voiceconn* botVoice = event.from()->get_voice(event.state.guild_id);
 
-    std::lock_guard lock(m_mutex);
+    std::lock_guard lock(guildMutex(guild->id));
     Info info = updateInfoProcessedInteractions(guild->id);
 
     if (event.state.user_id != me.id)
@@ -31,12 +31,12 @@ void Bot::Bot::onVoiceStateUpdate(const dpp::voice_state_update_t& event)
     *   Player instance is deleted when bot gracefully leaves voice channel.
     *   Bot was kicked if it wasn't deleted.
     */
-    PlayerEntry playerEntry = m_players.find(event.state.guild_id);
+    PlayerEntry playerEntry = findPlayer(event.state.guild_id);
     if (playerEntry != m_players.end())
     {
         info.stats().timesKicked += 1;
         playerEntry->second.endSession(info, Locale::EndReason::Kicked);
-        m_players.erase(event.state.guild_id);
+        erasePlayer(event.state.guild_id);
     }
 }
 
@@ -13,9 +13,9 @@ void Bot::Bot::onVoiceTrackMarker(const dpp::voice_track_marker_t& event)
         case Signal::Type::Played:
         case Signal::Type::ChapterReached:
         {
-            std::lock_guard lock(m_mutex);
+            std::lock_guard lock(guildMutex(event.voice_client->server_id));
             Info info = updateInfoProcessedInteractions(event.voice_client->server_id);
-            m_players.find(event.voice_client->server_id)->second.signalMarker(signal, info);
+            findPlayer(event.voice_client->server_id)->second.signalMarker(signal, info);
             return;
         }
         default:
@@ -0,0 +1,159 @@
+#include "bot/info_cache.hpp"
+using namespace kb::Bot::InfoCacheConst;
+
+// STL modules
+#include <vector>
+
+// Library {fmt}
+#include <fmt/format.h>
+
+// Custom modules
+#include "bot/locale/locales.hpp"
+#include "bot/info.hpp"
+#include "core/blocking_pool.hpp"
+#include "core/scheduler.hpp"
+#include "core/utility.hpp"
+
+namespace kb {
+
+/* Namespace aliases and imports */
+using namespace Bot::InfoConst;
+using namespace Bot::InfoStorageConst;
+
+Bot::InfoCache::InfoCache()
+    : m_logger(Utility::CreateLogger("info cache"))
+    , m_storage(std::make_unique<LogInfoStorage>(fmt::format("{}/{}", InfoDirectory, LogFilename)))
+    , m_flushScheduled(false)
+    , m_globalStats({})
+{}
+
+Bot::InfoCache::Shard& Bot::InfoCache::shard(uint64_t guildId)
+{
+    // Lowest snowflake bits are worker and sequence numbers, the timestamp spreads guilds better
+    return m_shards[(guildId >> 22) % ShardCount];
+}
+
+Bot::InfoCache::Entry& Bot::InfoCache::entry(Shard& shard, uint64_t guildId)
+{
+    auto entry = shard.entries.find(guildId);
+    if (entry != shard.entries.end())
+        return entry->second;
+
+    Entry newEntry;
+    newEntry.settings.locale = Locale::Create(LocaleEn::Type);
+    return shard.entries.emplace(guildId, std::move(newEntry)).first->second;
+}
+
+void Bot::InfoCache::scheduleFlush()
+{
+    // Changes made during the interval are written together
+    if (m_flushScheduled.exchange(true))
+        return;
+
+    // Writing waits for the disk, so only the timer runs on scheduler workers
+    Scheduler::Schedule([this]()
+    {
+        if (!BlockingPool::Post(FlushPoolKey, []() { Flush(); }))
+            m_flushScheduled = false;
+    }, FlushInterval);
+}
+
+void Bot::InfoCache::Load()
+{
+    InfoCache& cache = Instance();
+    std::lock_guard flushLock(cache.m_flushMutex);
+    InfoStorage::Records records = cache.m_storage->load();
+
+    Stats globalStats = {};
+    for (InfoStorage::Record& record : records)
+    {
+        globalStats += record.stats;
+        Shard& shard = cache.shard(record.guildId);
+        std::lock_guard lock(shard.mutex);
+        Entry& entry = shard.entries[record.guildId];
+        entry.settings = record.settings;
+        entry.stats = record.stats;
+    }
+
+    std::lock_guard lock(cache.m_globalStatsMutex);
+    cache.m_globalStats += globalStats;
+    cache.m_logger.info("Loaded info of {} guild{}", records.size(), LocaleEn::Cardinal(records.size()));
+}
+
+Bot::Stats Bot::InfoCache::GlobalStats()
+{
+    InfoCache& cache = Instance();
+    std::lock_guard lock(cache.m_globalStatsMutex);
+    return cache.m_globalStats;
+}
+
+void Bot::InfoCache::Get(dpp::snowflake guildId, Settings& settings, Stats& stats)
+{
+    InfoCache& cache = Instance();
+    Shard& shard = cache.shard(guildId);
+    std::lock_guard lock(shard.mutex);
+    const Entry& entry = cache.entry(shard, guildId);
+    settings = entry.settings;
+    stats = entry.stats;
+}
+
+void Bot::InfoCache::Update(dpp::snowflake guildId, const Settings* settings, const Stats& statsIncrement)
+{
+    InfoCache& cache = Instance();
+    Shard& shard = cache.shard(guildId);
+    {
+        std::lock_guard lock(shard.mutex);
+        Entry& entry = cache.entry(shard, guildId);
+        if (settings)
+            entry.settings = *settings;
+        entry.stats += statsIncrement;
+        entry.dirty = true;
+    }
+
+    {
+        std::lock_guard lock(cache.m_globalStatsMutex);
+        cache.m_globalStats += statsIncrement;
+    }
+    cache.scheduleFlush();
+}
+
+void Bot::InfoCache::Flush()
+{
+    InfoCache& cache = Instance();
+    std::lock_guard lock(cache.m_flushMutex);
+    cache.m_flushScheduled = false;
+
+    // Entries are copied, so info is written without blocking the shards
+    InfoStorage::Records records;
+    for (Shard& shard : cache.m_shards)
+    {
+        std::lock_guard shardLock(shard.mutex);
+        for (auto& entry : shard.entries)
+        {
+            if (!entry.second.dirty)
+                continue;
+            entry.second.dirty = false;
+            records.push_back({ entry.first, entry.second.settings, entry.second.stats });
+        }
+    }
+
+    if (records.empty())
+        return;
+
+    if (cache.m_storage->write(records))
+    {
+        cache.m_logger.debug("Saved info of {} guild{}", records.size(), LocaleEn::Cardinal(records.size()));
+        return;
+    }
+
+    cache.m_logger.error("Couldn't save info of {} guild{}", records.size(), LocaleEn::Cardinal(records.size()));
+    for (const InfoStorage::Record& record : records)
+    {
+        Shard& shard = cache.shard(record.guildId);
+        std::lock_guard shardLock(shard.mutex);
+        shard.entries.at(record.guildId).dirty = true;
+    }
+    cache.scheduleFlush();
+}
+
+} // namespace kb
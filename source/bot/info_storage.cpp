@@ -0,0 +1,396 @@
+#include "bot/info_storage.hpp"
+using namespace kb::Bot::InfoStorageConst;
+
+// STL modules
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_map>
+
+// Library nlohmann::json
+#include <nlohmann/json.hpp>
+
+// Library Boost.CRC
+#include <boost/crc.hpp>
+
+// Library Boost.Regex
+#include <boost/regex.hpp>
+
+// Library {fmt}
+#include <fmt/format.h>
+
+// Custom modules
+#include "bot/info.hpp"
+#include "bot/locale/locales.hpp"
+#include "core/io.hpp"
+#include "core/utility.hpp"
+
+namespace kb {
+
+/* Namespace aliases and imports */
+using nlohmann::json;
+using namespace Bot::InfoConst;
+
+/*
+*   Info log record layout, all integers are little-endian:
+*       4 bytes: payload size
+*       4 bytes: CRC-32 of payload
+*       payload:
+*           8 bytes: guild ID
+*           8 bytes: timeout minutes
+*           1 byte: change status flag
+*           5 * 8 bytes: stats
+*           1 byte: locale name length
+*           N bytes: locale name
+*/
+constexpr size_t RecordHeaderSize = 8;
+constexpr size_t PayloadFixedSize = 8 + 8 + 1 + 5 * 8 + 1;
+
+/// @brief Append little-endian integer to buffer
+/// @param buffer The buffer to append to
+/// @param value The integer to append
+/// @param size Count of integer bytes to append
+static void PutInteger(std::string& buffer, uint64_t value, size_t size)
+{
+    for (size_t index = 0; index < size; ++index)
+        buffer.push_back(static_cast<char>((value >> (index * 8)) & 0xFF));
+}
+
+/// @brief Read little-endian integer
+/// @param data Integer bytes
+/// @param size Count of integer bytes
+/// @return Read integer
+static uint64_t GetInteger(const char* data, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t index = 0; index < size; ++index)
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[index])) << (index * 8);
+    return value;
+}
+
+/// @brief Calculate CRC-32 checksum
+/// @param data Data to calculate checksum of
+/// @param size Size of the data
+/// @return Calculated checksum
+static uint32_t Checksum(const char* data, size_t size)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(data, size);
+    return crc.checksum();
+}
+
+/// @brief Append info log record to buffer
+/// @param buffer The buffer to append to
+/// @param record The record to append
+static void EncodeRecord(std::string& buffer, const Bot::InfoStorage::Record& record)
+{
+    std::string localeName = record.settings.locale->name();
+    localeName.resize(std::min<size_t>(localeName.size(), 0xFF));
+
+    std::string payload;
+    payload.reserve(PayloadFixedSize + localeName.size());
+    PutInteger(payload, record.guildId, 8);
+    PutInteger(payload, record.settings.timeoutMinutes, 8);
+    PutInteger(payload, record.settings.changeStatus, 1);
+    PutInteger(payload, record.stats.interactionsProcessed, 8);
+    PutInteger(payload, record.stats.sessionsConducted, 8);
+    PutInteger(payload, record.stats.tracksPlayed, 8);
+    PutInteger(payload, record.stats.timesKicked, 8);
+    PutInteger(payload, record.stats.timesMoved, 8);
+    PutInteger(payload, localeName.size(), 1);
+    payload += localeName;
+
+    PutInteger(buffer, payload.size(), 4);
+    PutInteger(buffer, Checksum(payload.data(), payload.size()), 4);
+    buffer += payload;
+}
+
+/// @brief Parse info log record payload
+/// @param data Payload bytes
+/// @param size Payload size
+/// @param record Record to parse payload to
+/// @return True if the payload is valid
+static bool DecodeRecord(const char* data, size_t size, Bot::InfoStorage::Record& record)
+{
+    if (size < PayloadFixedSize || size != PayloadFixedSize + static_cast<uint8_t>(data[PayloadFixedSize - 1]))
+        return false;
+
+    record.guildId = GetInteger(data, 8);
+    record.settings.timeoutMinutes = GetInteger(data + 8, 8);
+    record.settings.changeStatus = data[16] != 0;
+    record.stats.interactionsProcessed = GetInteger(data + 17, 8);
+    record.stats.sessionsConducted = GetInteger(data + 25, 8);
+    record.stats.tracksPlayed = GetInteger(data + 33, 8);
+    record.stats.timesKicked = GetInteger(data + 41, 8);
+    record.stats.timesMoved = GetInteger(data + 49, 8);
+    record.settings.locale = Bot::Locale::Create(std::string(data + PayloadFixedSize, size - PayloadFixedSize));
+    return true;
+}
+
+/// @brief Write whole buffer to file
+/// @param fileDescriptor Descriptor of the file
+/// @param buffer The buffer to write
+/// @return True if the buffer was written and reached the disk
+static bool WriteAndSync(int fileDescriptor, const std::string& buffer)
+{
+    return IO::WriteAll(fileDescriptor, buffer) && IO::SyncFile(fileDescriptor);
+}
+
+Bot::JsonInfoStorage::JsonInfoStorage(const std::string& directory)
+    : m_logger(Utility::CreateLogger("json info storage"))
+    , m_directory(directory)
+{}
+
+std::string Bot::JsonInfoStorage::filePath(uint64_t guildId) const
+{
+    return fmt::format("{}/{}.json", m_directory, guildId);
+}
+
+Bot::InfoStorage::Records Bot::JsonInfoStorage::load()
+{
+    Records records;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(m_directory, error))
+    {
+        boost::smatch matches;
+        std::string filename = file.path().filename().string();
+        if (!boost::regex_search(filename, matches, boost::regex(R"(^(\d+)\.json$)")))
+            continue;
+
+        std::ifstream infoFile(file.path());
+        if (!infoFile)
+        {
+            m_logger.warn("Couldn't open info file \"{}\", skipping it", filename);
+            continue;
+        }
+
+        try
+        {
+            json infoJson = json::parse(infoFile);
+            Record record;
+            record.guildId = std::stoull(matches.str(1));
+
+            json settingsJson = infoJson.at(Fields::Settings);
+            record.settings.locale = Locale::Create(settingsJson.at(Fields::Locale).get<std::string>());
+            record.settings.timeoutMinutes = settingsJson.at(Fields::Timeout);
+            record.settings.changeStatus = settingsJson.at(Fields::ChangeStatus);
+
+            json statsJson = infoJson.at(Fields::Stats);
+            record.stats.interactionsProcessed = statsJson.at(Fields::InteractionsProcessed);
+            record.stats.sessionsConducted = statsJson.at(Fields::SessionsConducted);
+            record.stats.tracksPlayed = statsJson.at(Fields::TracksPlayed);
+            record.stats.timesKicked = statsJson.at(Fields::TimesKicked);
+            record.stats.timesMoved = statsJson.at(Fields::TimesMoved);
+            records.push_back(std::move(record));
+        }
+        catch (const std::exception& exception)
+        {
+            m_logger.warn("Couldn't parse info file \"{}\", skipping it: {}", filename, exception.what());
+        }
+    }
+
+    if (error)
+        throw std::runtime_error(fmt::format("kb::Bot::JsonInfoStorage::load(): Couldn't read info directory [directory: \"{}\", error: \"{}\"]", m_directory, error.message()));
+    return records;
+}
+
+bool Bot::JsonInfoStorage::write(const Records& records)
+{
+    bool allWritten = true;
+    for (const Record& record : records)
+    {
+        json settingsJson;
+        settingsJson[Fields::Locale] = record.settings.locale->name();
+        settingsJson[Fields::Timeout] = record.settings.timeoutMinutes;
+        settingsJson[Fields::ChangeStatus] = record.settings.changeStatus;
+
+        json statsJson;
+        statsJson[Fields::InteractionsProcessed] = record.stats.interactionsProcessed;
+        statsJson[Fields::SessionsConducted] = record.stats.sessionsConducted;
+        statsJson[Fields::TracksPlayed] = record.stats.tracksPlayed;
+        statsJson[Fields::TimesKicked] = record.stats.timesKicked;
+        statsJson[Fields::TimesMoved] = record.stats.timesMoved;
+
+        json infoJson;
+        infoJson[Fields::Settings] = settingsJson;
+        infoJson[Fields::Stats] = statsJson;
+
+        // Interrupted write must not leave a truncated info file behind
+        std::string path = filePath(record.guildId);
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream infoFile(temporaryPath, std::ios::trunc);
+            if (!infoFile || !(infoFile << infoJson.dump(4) << '\n') || !infoFile.flush())
+            {
+                allWritten = false;
+                continue;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error)
+            allWritten = false;
+    }
+    return allWritten;
+}
+
+Bot::LogInfoStorage::LogInfoStorage(const std::string& path)
+    : m_logger(Utility::CreateLogger("info log"))
+    , m_path(path)
+    , m_recordCount(0)
+{}
+
+Bot::InfoStorage::Records Bot::LogInfoStorage::read(size_t& recordCount)
+{
+    recordCount = 0;
+    if (!std::filesystem::exists(m_path))
+        return {};
+
+    std::ifstream logFile(m_path, std::ios::binary);
+    if (!logFile)
+        throw std::runtime_error(fmt::format("kb::Bot::LogInfoStorage::read(): Couldn't open info log [file: \"{}\"]", m_path));
+    std::string contents((std::istreambuf_iterator<char>(logFile)), std::istreambuf_iterator<char>());
+    logFile.close();
+
+    // Empty file is left when the first write was interrupted
+    if (contents.empty())
+        return {};
+    if (contents.size() < sizeof(LogMagic) || std::memcmp(contents.data(), LogMagic, sizeof(LogMagic)) != 0)
+        throw std::runtime_error(fmt::format("kb::Bot::LogInfoStorage::read(): File is not an info log [file: \"{}\"]", m_path));
+
+    std::unordered_map<uint64_t, Record> latestRecords;
+    size_t offset = sizeof(LogMagic);
+    while (offset < contents.size())
+    {
+        if (contents.size() - offset < RecordHeaderSize)
+            break;
+
+        size_t payloadSize = GetInteger(contents.data() + offset, 4);
+        uint32_t checksum = static_cast<uint32_t>(GetInteger(contents.data() + offset + 4, 4));
+        const char* payload = contents.data() + offset + RecordHeaderSize;
+        if (payloadSize > contents.size() - offset - RecordHeaderSize || Checksum(payload, payloadSize) != checksum)
+            break;
+
+        Record record;
+        if (!DecodeRecord(payload, payloadSize, record))
+            break;
+
+        uint64_t guildId = record.guildId;
+        latestRecords[guildId] = std::move(record);
+        offset += RecordHeaderSize + payloadSize;
+        ++recordCount;
+    }
+
+    // Records after a damaged one can't be trusted: the file is cut there, keeping a copy for inspection
+    if (offset < contents.size())
+    {
+        std::string damagedPath = m_path + ".damaged";
+        std::error_code error;
+        std::filesystem::copy_file(m_path, damagedPath, std::filesystem::copy_options::overwrite_existing, error);
+        std::filesystem::resize_file(m_path, offset, error);
+        if (error)
+            throw std::runtime_error(fmt::format("kb::Bot::LogInfoStorage::read(): Couldn't cut off damaged info log tail [file: \"{}\", error: \"{}\"]", m_path, error.message()));
+
+        m_logger.warn(
+            "Info log is damaged at offset {}: {} byte{} cut off, original file is saved as \"{}\"",
+            offset, contents.size() - offset, LocaleEn::Cardinal(contents.size() - offset), damagedPath
+        );
+    }
+
+    Records records;
+    records.reserve(latestRecords.size());
+    for (auto& record : latestRecords)
+        records.push_back(std::move(record.second));
+    return records;
+}
+
+bool Bot::LogInfoStorage::compact()
+{
+    size_t recordCount = 0;
+    Records records;
+    try
+    {
+        records = read(recordCount);
+    }
+    catch (const std::runtime_error& error)
+    {
+        m_logger.error("Couldn't compact info log: {}", error.what());
+        return false;
+    }
+
+    std::string buffer(LogMagic, sizeof(LogMagic));
+    for (const Record& record : records)
+        EncodeRecord(buffer, record);
+
+    // New log replaces the old one only when it's complete
+    std::string temporaryPath = m_path + ".tmp";
+    int fileDescriptor = IO::OpenForWriting(temporaryPath, false);
+    if (fileDescriptor < 0)
+        return false;
+    bool written = WriteAndSync(fileDescriptor, buffer);
+    IO::CloseFile(fileDescriptor);
+
+    std::error_code error;
+    if (written)
+        std::filesystem::rename(temporaryPath, m_path, error);
+    if (!written || error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        m_logger.error("Couldn't write compacted info log");
+        return false;
+    }
+    IO::SyncDirectory(m_path);
+
+    m_logger.info("Compacted info log: {} records -> {}", recordCount, records.size());
+    m_recordCount = records.size();
+    return true;
+}
+
+Bot::InfoStorage::Records Bot::LogInfoStorage::load()
+{
+    Records records = read(m_recordCount);
+    m_guildIds.clear();
+    for (const Record& record : records)
+        m_guildIds.insert(record.guildId);
+    return records;
+}
+
+bool Bot::LogInfoStorage::write(const Records& records)
+{
+    if (records.empty())
+        return true;
+
+    int fileDescriptor = IO::OpenForWriting(m_path, true);
+    if (fileDescriptor < 0)
+        return false;
+
+    int64_t originalSize = IO::FileSize(fileDescriptor);
+    std::string buffer;
+    if (originalSize == 0)
+        buffer.assign(LogMagic, sizeof(LogMagic));
+    for (const Record& record : records)
+        EncodeRecord(buffer, record);
+
+    // Partially appended records would hide everything appended after them
+    bool written = originalSize >= 0 && WriteAndSync(fileDescriptor, buffer);
+    if (!written && originalSize >= 0)
+        IO::TruncateFile(fileDescriptor, originalSize);
+    IO::CloseFile(fileDescriptor);
+    if (!written)
+        return false;
+    if (originalSize == 0)
+        IO::SyncDirectory(m_path);
+
+    m_recordCount += records.size();
+    for (const Record& record : records)
+        m_guildIds.insert(record.guildId);
+    if (m_recordCount >= MinCompactionRecords && m_recordCount > CompactionRatio * m_guildIds.size())
+        compact();
+    return true;
+}
+
+} // namespace kb
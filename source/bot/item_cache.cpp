@@ -0,0 +1,114 @@
+#include "bot/item_cache.hpp"
+using namespace kb::Bot::ItemCacheConst;
+
+// STL modules
+#include <exception>
+#include <iterator>
+
+namespace kb {
+
+std::shared_ptr<const ytcpp::Item> Bot::ItemCache::find(const std::string& itemId)
+{
+    auto entry = m_entries.find(itemId);
+    if (entry == m_entries.end())
+        return {};
+
+    if (Clock::now() >= entry->second.expiration)
+    {
+        m_usage.erase(entry->second.usage);
+        m_entries.erase(entry);
+        return {};
+    }
+
+    m_usage.splice(m_usage.end(), m_usage, entry->second.usage);
+    return entry->second.item;
+}
+
+void Bot::ItemCache::insert(const std::string& itemId, std::shared_ptr<const ytcpp::Item> item)
+{
+    const Clock::time_point expiration = Clock::now() + ItemTtl;
+    auto entry = m_entries.find(itemId);
+    if (entry != m_entries.end())
+    {
+        entry->second.item = std::move(item);
+        entry->second.expiration = expiration;
+        m_usage.splice(m_usage.end(), m_usage, entry->second.usage);
+        return;
+    }
+
+    // Evicted items stay alive while somebody holds them
+    while (m_entries.size() >= MaxItems)
+    {
+        m_entries.erase(m_usage.front());
+        m_usage.pop_front();
+    }
+
+    m_usage.push_back(itemId);
+    m_entries.emplace(itemId, Entry{ std::move(item), expiration, std::prev(m_usage.end()) });
+}
+
+std::string Bot::ItemCache::ItemId(const ytcpp::Item& item)
+{
+    if (item.type() == ytcpp::Item::Type::Video)
+        return std::get<ytcpp::Video>(item).id();
+    return std::get<ytcpp::Playlist>(item).id();
+}
+
+std::shared_ptr<const ytcpp::Item> Bot::ItemCache::Put(const ytcpp::Item& item)
+{
+    ItemCache& cache = Instance();
+    std::string itemId = ItemId(item);
+    auto cachedItem = std::make_shared<const ytcpp::Item>(item);
+
+    std::lock_guard lock(cache.m_mutex);
+    cache.insert(itemId, cachedItem);
+    return cachedItem;
+}
+
+std::shared_ptr<const ytcpp::Item> Bot::ItemCache::Get(ytcpp::Item::Type type, std::string_view itemId)
+{
+    ItemCache& cache = Instance();
+    std::string id(itemId);
+    std::promise<std::shared_ptr<const ytcpp::Item>> promise;
+    std::unique_lock lock(cache.m_mutex);
+    if (std::shared_ptr<const ytcpp::Item> item = cache.find(id))
+        return item;
+
+    auto pendingItem = cache.m_pendingItems.find(id);
+    if (pendingItem != cache.m_pendingItems.end())
+    {
+        std::shared_future<std::shared_ptr<const ytcpp::Item>> future = pendingItem->second;
+        lock.unlock();
+        return future.get();
+    }
+
+    cache.m_pendingItems.emplace(id, promise.get_future().share());
+    lock.unlock();
+
+    // Resolving waits for YouTube, so it's done unlocked. Failures aren't cached.
+    std::shared_ptr<const ytcpp::Item> item;
+    try
+    {
+        if (type == ytcpp::Item::Type::Video)
+            item = std::make_shared<const ytcpp::Item>(ytcpp::Video(id));
+        else
+            item = std::make_shared<const ytcpp::Item>(ytcpp::Playlist(id));
+    }
+    catch (...)
+    {
+        lock.lock();
+        cache.m_pendingItems.erase(id);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    lock.lock();
+    cache.insert(id, item);
+    cache.m_pendingItems.erase(id);
+    lock.unlock();
+    promise.set_value(item);
+    return item;
+}
+
+} // namespace kb
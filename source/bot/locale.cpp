@@ -348,11 +348,11 @@ dpp::message Bot::Locale::SessionMessage(const SessionStrings& strings, Cardinal
             }
 
             const Session::EnqueuedItem& item = session.queue[index];
-            switch (item.item.type())
+            switch (item.item->type())
             {
                 case ytcpp::Item::Type::Video:
                 {
-                    const ytcpp::Video& video = std::get<ytcpp::Video>(item.item);
+                    const ytcpp::Video& video = std::get<ytcpp::Video>(*item.item);
                     embed.add_field(fmt::format(
                         "{}. {}",
                         index + 1,
@@ -363,13 +363,13 @@ dpp::message Bot::Locale::SessionMessage(const SessionStrings& strings, Cardinal
                         Utility::NiceString(video.duration())
                     ) + '\n' + fmt::format(
                         fmt::runtime(strings.requestedBy),
-                        item.requester.format_username()
+                        session.requester(item).format_username()
                     ));
                     break;
                 }
                 case ytcpp::Item::Type::Playlist:
                 {
-                    const ytcpp::Playlist& playlist = std::get<ytcpp::Playlist>(item.item);
+                    const ytcpp::Playlist& playlist = std::get<ytcpp::Playlist>(*item.item);
                     embed.add_field(fmt::format(
                         "{}. {}",
                         index + 1,
@@ -381,7 +381,7 @@ dpp::message Bot::Locale::SessionMessage(const SessionStrings& strings, Cardinal
                         cardinalFunction(playlist.videoCount())
                     ) + '\n' + fmt::format(
                         fmt::runtime(strings.requestedBy),
-                        item.requester.format_username()
+                        session.requester(item).format_username()
                     ));
                     break;
                 }
@@ -599,7 +599,7 @@ dpp::message Bot::Locale::SearchMessage(const SearchStrings& strings, CardinalFu
     return SuccessMessage(strings.whatAreWePlaying).set_flags(0).add_component(actionRow);
 }
 
-dpp::message Bot::Locale::EndMessage(const EndStrings& strings, const Settings& settings, EndReason reason, Session session)
+dpp::message Bot::Locale::EndMessage(const EndStrings& strings, const Settings& settings, EndReason reason, const Session& session)
 {
     dpp::embed embed;
     embed.set_author(fmt::format(
@@ -3,6 +3,7 @@
 // STL modules
 #include <random>
 #include <algorithm>
+#include <stdexcept>
 
 // Library {fmt}
 #include <fmt/format.h>
@@ -10,7 +11,11 @@
 // Custom modules
 #include "bot/locale/locale_en.hpp"
 #include "bot/bot.hpp"
+#include "bot/item_cache.hpp"
+#include "core/blocking_pool.hpp"
+#include "core/config.hpp"
 #include "core/downloader.hpp"
+#include "core/format_cache.hpp"
 #include "core/utility.hpp"
 
 namespace kb {
@@ -47,14 +52,169 @@ Bot::Player::Player(Bot* root, dpp::discord_client* client, const dpp::interacti
         info.stats().sessionsConducted += 1,
         interaction.get_issuing_user()
     })
+    , m_sessionSnapshot(std::make_shared<const Session>(m_session))
 {}
 
 Bot::Player::~Player()
 {
-    if (m_threadStatus == ThreadStatus::Running)
-        m_threadStatus = ThreadStatus::Stopped;
-    if (m_thread.joinable())
-        m_thread.join();
+    {
+        std::unique_lock lock(m_mutex);
+        stopPlayback(lock);
+    }
+    discardPrefetch(m_prefetch);
+}
+
+std::string Bot::Player::nextVideoId()
+{
+    ytcpp::Playlist::Iterator iterator;
+    if (m_session.playingPlaylist && m_session.playingPlaylist->iterator)
+    {
+        iterator = m_session.playingPlaylist->iterator;
+    }
+    else
+    {
+        if (m_session.queue.empty())
+            return {};
+
+        const ytcpp::Item& nextItem = *m_session.queue[0].item;
+        if (nextItem.type() == ytcpp::Item::Type::Video)
+        {
+            const ytcpp::Video& video = std::get<ytcpp::Video>(nextItem);
+            if (video.isLivestream() || video.isUpcoming())
+                return {};
+            return video.id();
+        }
+        iterator = std::get<ytcpp::Playlist>(nextItem).begin();
+    }
+
+    // Livestreams and premieres are skipped, there is nothing to prefetch
+    if (!iterator || iterator->isLivestream() || iterator->isUpcoming())
+        return {};
+    return iterator->id();
+}
+
+void Bot::Player::RunPrefetch(dpp::snowflake guildId, const std::shared_ptr<Prefetch>& prefetch, std::function<void(std::unique_ptr<Downloader>&)> operation)
+{
+    const bool posted = BlockingPool::Post(guildId, [prefetch, operation = std::move(operation)]()
+    {
+        std::unique_ptr<Downloader> downloader;
+        {
+            std::lock_guard lock(prefetch->mutex);
+            if (prefetch->discarded)
+                return;
+            downloader = std::move(prefetch->downloader);
+        }
+
+        std::exception_ptr error;
+        try
+        {
+            operation(downloader);
+        }
+        catch (...)
+        {
+            /*
+            *   Prefetch of the next video is opened again when it's its turn.
+            *   The error is only reported if opening or seeking the playing video fails.
+            */
+            downloader.reset();
+            error = std::current_exception();
+        }
+
+        std::lock_guard lock(prefetch->mutex);
+        if (!prefetch->discarded)
+        {
+            prefetch->downloader = std::move(downloader);
+            prefetch->error = error;
+        }
+        prefetch->finished = true;
+        if (prefetch->onFinished)
+            Scheduler::Post(std::move(prefetch->onFinished));
+        prefetch->onFinished = nullptr;
+    });
+    if (!posted)
+    {
+        std::lock_guard lock(prefetch->mutex);
+        prefetch->error = std::make_exception_ptr(std::runtime_error("Blocking pool is stopped"));
+        prefetch->finished = true;
+    }
+}
+
+std::shared_ptr<Bot::Player::Prefetch> Bot::Player::StartPrefetch(dpp::snowflake guildId, const std::string& videoId)
+{
+    auto prefetch = std::make_shared<Prefetch>();
+    prefetch->videoId = videoId;
+
+    // Opening waits for YouTube, so it doesn't run on scheduler workers
+    RunPrefetch(guildId, prefetch, [videoId](std::unique_ptr<Downloader>& downloader) { downloader = std::make_unique<Downloader>(videoId); });
+    return prefetch;
+}
+
+std::shared_ptr<Bot::Player::Prefetch> Bot::Player::StartSeek(dpp::snowflake guildId, const std::string& videoId, std::unique_ptr<Downloader> downloader, int64_t timestamp)
+{
+    auto prefetch = std::make_shared<Prefetch>();
+    prefetch->videoId = videoId;
+    prefetch->downloader = std::move(downloader);
+
+    // Seeking waits for the transfer to restart and may read cues over the network
+    RunPrefetch(guildId, prefetch, [timestamp](std::unique_ptr<Downloader>& downloader) { downloader->seekTo(timestamp); });
+    return prefetch;
+}
+
+void Bot::Player::updatePrefetch()
+{
+    // Next video is only prefetched while the current one is playing
+    if (m_playbackStatus != PlaybackStatus::Running)
+        return;
+
+    std::string videoId = nextVideoId();
+    if (m_prefetch && m_prefetch->videoId == videoId)
+        return;
+
+    discardPrefetch(m_prefetch);
+    if (videoId.empty())
+        return;
+    m_prefetch = StartPrefetch(m_session.guildId, videoId);
+}
+
+void Bot::Player::discardPrefetch(std::shared_ptr<Prefetch>& prefetch)
+{
+    if (!prefetch)
+        return;
+
+    std::unique_ptr<Downloader> downloader;
+    {
+        std::lock_guard lock(prefetch->mutex);
+        prefetch->discarded = true;
+        prefetch->onFinished = nullptr;
+        downloader = std::move(prefetch->downloader);
+    }
+    prefetch.reset();
+}
+
+void Bot::Player::enqueue(const ytcpp::Item& item, const dpp::user& requester)
+{
+    // Queue holds the cached item: it is never resolved again while it is waiting
+    Session::EnqueuedItem enqueuedItem = {};
+    enqueuedItem.item = ItemCache::Put(item);
+
+    auto requesterEntry = std::find_if(
+        m_session.requesters.begin(),
+        m_session.requesters.end(),
+        [&requester](const dpp::user& user) { return user.id == requester.id; }
+    );
+    enqueuedItem.requesterIndex = static_cast<uint32_t>(requesterEntry - m_session.requesters.begin());
+    if (requesterEntry == m_session.requesters.end())
+        m_session.requesters.push_back(requester);
+
+    m_session.queue.push_back(std::move(enqueuedItem));
+
+    // Queued videos start without waiting for their audio URL
+    if (item.type() == ytcpp::Item::Type::Video)
+    {
+        const ytcpp::Video& video = std::get<ytcpp::Video>(item);
+        if (!video.isLivestream() && !video.isUpcoming())
+            FormatCache::Prefetch(video.id(), m_session.guildId);
+    }
 }
 
 void Bot::Player::extractNextVideo(const Info& info)
@@ -83,19 +243,19 @@ void Bot::Player::extractNextVideo(const Info& info)
             return;
     }
 
-    Session::EnqueuedItem& nextItem = m_session.queue[0];
-    m_session.playingRequester.emplace(std::move(nextItem.requester));
-    switch (nextItem.item.type())
+    std::shared_ptr<const ytcpp::Item> nextItem = m_session.queue[0].item;
+    m_session.playingRequester.emplace(m_session.requester(m_session.queue[0]));
+    switch (nextItem->type())
     {
         case ytcpp::Item::Type::Video:
-            m_session.playingVideo.emplace(Session::PlayingVideo{ std::move(std::get<ytcpp::Video>(nextItem.item)) });
+            m_session.playingVideo.emplace(Session::PlayingVideo{ std::get<ytcpp::Video>(*nextItem) });
             /* Temporarily unsupported!
             if (!m_session.playingVideo->video.chapters().empty())
                 chapterReached(m_session.playingVideo->video.chapters()[0], info);
             */
             break;
         case ytcpp::Item::Type::Playlist:
-            m_session.playingPlaylist.emplace(Session::PlayingPlaylist{ std::move(std::get<ytcpp::Playlist>(nextItem.item)), {} });
+            m_session.playingPlaylist.emplace(Session::PlayingPlaylist{ std::get<ytcpp::Playlist>(*nextItem), {} });
             m_session.playingPlaylist->iterator = m_session.playingPlaylist->playlist.begin();
             m_session.playingVideo.emplace(Session::PlayingVideo{ *(m_session.playingPlaylist->iterator++) });
             /* Temporarily unsupported!
@@ -124,10 +284,16 @@ void Bot::Player::chapterReached(const ytcpp::Video::Chapter& chapter, const Inf
 }
 */
 
+void Bot::Player::publishSession()
+{
+    // Readers share the snapshot: the session is copied once per change, not once per read
+    m_sessionSnapshot.store(std::make_shared<const Session>(m_session));
+}
+
 void Bot::Player::checkPlayingVideo()
 {
     if (m_session.playingVideo)
-        startThread();
+        startPlayback();
     else
         m_timeout.enable();
 }
@@ -196,170 +362,250 @@ void Bot::Player::updateStatus(const Info& info)
     ));
 }
 
-void Bot::Player::threadFunction()
+void Bot::Player::playbackStep()
 {
-    std::string videoId;
-    {
-        std::lock_guard lock(m_mutex);
-        if (!m_session.playingVideo)
-        {
-            m_threadStatus = ThreadStatus::Idle;
-            return;
-        }
-
-        if (m_session.playingVideo->video.isLivestream() || m_session.playingVideo->video.isUpcoming())
-        {
-            dpp::discord_voice_client* client = getVoiceClient();
-            if (!client)
-                return;
-
-            if (m_session.playingVideo->video.isLivestream()) {
-                client->insert_marker(Signal(Signal::Type::LivestreamSkipped, m_session.playingVideo->video.id()));
-                m_logger.info("Skipping livestream \"{}\"", m_session.playingVideo->video.title());
-            }
-            else if (m_session.playingVideo->video.isUpcoming()) {
-                client->insert_marker(Signal(Signal::Type::PremiereSkipped, m_session.playingVideo->video.id()));
-                m_logger.info("Skipping premiere \"{}\"", m_session.playingVideo->video.title());
-            }
-            return;
-        }
-
-        m_threadStatus = ThreadStatus::Running;
-        videoId = m_session.playingVideo->video.id();
-        m_timeout.disable();
-    }
-
-    bool errorOccured = false;
     try
     {
-        Downloader downloader(videoId); 
-/* Temporarily unsupported!
-        ytcpp::Video::Chapter lastChapter;
-*/
-        pt::time_duration lastCheckTimestamp;
-        while (true)
-        {
-            Downloader::Frame frame = downloader.extractFrame();
-            if (frame.empty())
-                break;
-
-            {
-                std::lock_guard lock(m_mutex);
-                if (m_threadStatus == ThreadStatus::Stopped)
-                    return;
-
-                if (m_session.seekTimestamp != -1)
-                {
-                    dpp::discord_voice_client* client = getVoiceClient();
-                    if (!client)
-                    {
-                        m_threadStatus = ThreadStatus::Idle;
-                        return;
-                    }
-                    client->stop_audio();
-
-                    downloader.seekTo(m_session.seekTimestamp);
-                    m_session.seekTimestamp = -1;
-                }
-
-/* Temporarily unsupported!
-                if (!m_session.playingVideo->video.chapters().empty())
-                {
-                    pt::time_duration currentTimestamp(0, 0, 0, frame.timestamp() * 1'000);
-                    if (std::abs((currentTimestamp - lastCheckTimestamp).total_seconds()) >= 1)
-                    {
-                        lastCheckTimestamp = currentTimestamp;
-                        auto chapterEntry = DeduceChapter(m_session.playingVideo->video.chapters(), currentTimestamp);
-                        if (chapterEntry->timestamp != lastChapter.timestamp)
-                        {
-                            lastChapter = *chapterEntry;
-
-                            dpp::discord_voice_client* client = getVoiceClient();
-                            if (!client)
-                            {
-                                m_threadStatus = ThreadStatus::Idle;
-                                return;
-                            }
-                            client->insert_marker(Signal(Signal::Type::ChapterReached, chapterEntry->name));
-                        }
-                    }
-                }
-*/
-
-                dpp::discord_voice_client* client = getVoiceClient();
-                if (!client)
-                {
-                    m_threadStatus = ThreadStatus::Idle;
-                    return;
-                }
-                client->send_audio_raw(reinterpret_cast<uint16_t*>(frame.data()), frame.size());
-            }
-        }
+        playFrames();
+        return;
     }
     catch (const ytcpp::YtError& error)
     {
         m_logger.error(
             "Couldn't play \"{}\": YouTube error: {}",
-            m_session.playingVideo->video.id(),
+            m_playbackVideoId,
             error.what()
         );
-        errorOccured = true;
     }
     catch (const ytcpp::Error& error)
     {
         m_logger.error(
             "Couldn't play \"{}\": ytcpp error: {}",
-            m_session.playingVideo->video.id(),
+            m_playbackVideoId,
             error.what()
         );
-        errorOccured = true;
     }
     catch (const std::runtime_error& error)
     {
         m_logger.error(
             "Couldn't play \"{}\": Runtime error: {}",
-            m_session.playingVideo->video.id(),
+            m_playbackVideoId,
             error.what()
         );
-        errorOccured = true;
     }
     catch (const std::exception& error)
     {
         m_logger.error(
             "Couldn't play \"{}\": Unknown error: {}",
-            m_session.playingVideo->video.id(),
+            m_playbackVideoId,
             error.what()
         );
-        errorOccured = true;
     }
     catch (...)
     {
         m_logger.error(
             "Couldn't play \"{}\": Unknown error",
-            m_session.playingVideo->video.id()
+            m_playbackVideoId
         );
-        errorOccured = true;
     }
 
     std::lock_guard lock(m_mutex);
-    dpp::discord_voice_client* client = getVoiceClient();
-    if (!client)
+    finishPlayback(Signal::Type::PlayError);
+}
+
+void Bot::Player::playFrames()
+{
+    std::unique_lock lock(m_mutex);
+    m_playbackTimer = 0;
+    if (m_playbackStatus == PlaybackStatus::Stopped)
     {
-        m_threadStatus = ThreadStatus::Idle;
+        finishPlayback({});
         return;
     }
 
-    if (errorOccured)
+    // Seeking downloader is taken from the player like an opening one, until it's done
+    if (m_session.seekTimestamp != -1 && m_downloader)
     {
-        Info info(m_session.guildId);
-        m_root->message_create(info.settings().locale->playError(m_session.playingVideo->video).set_channel_id(m_session.textChannelId));
-        client->insert_marker(Signal(Signal::Type::PlayError, videoId));
-        m_threadStatus = ThreadStatus::Idle;
-        return;
+        dpp::discord_voice_client* client = getVoiceClient();
+        if (client)
+            client->stop_audio();
+        m_opening = StartSeek(m_session.guildId, m_playbackVideoId, std::move(m_downloader), m_session.seekTimestamp);
+        m_session.seekTimestamp = -1;
+    }
+
+    if (!m_downloader)
+    {
+        std::unique_ptr<Downloader> downloader;
+        std::exception_ptr error;
+        {
+            std::lock_guard openingLock(m_opening->mutex);
+            if (!m_opening->finished)
+            {
+                // Step runs again when the downloader is opened or seeked
+                m_opening->onFinished = [this]() { playbackStep(); };
+                return;
+            }
+            downloader = std::move(m_opening->downloader);
+            error = m_opening->error;
+        }
+
+        m_opening.reset();
+        if (!downloader)
+            std::rethrow_exception(error);
+        m_downloader = std::move(downloader);
+        updatePrefetch();
     }
 
-    client->insert_marker(Signal(Signal::Type::Played, videoId));
-    m_threadStatus = ThreadStatus::Idle;
+    const float lowWatermark = Config::PlayerLowWatermark() / 1000.0f;
+    const float highWatermark = Config::PlayerHighWatermark() / 1000.0f;
+    for (int frameIndex = 0; frameIndex < PlayerConst::MaxBatchFrames; ++frameIndex)
+    {
+        dpp::discord_voice_client* client = getVoiceClient();
+        if (!client)
+        {
+            finishPlayback({});
+            return;
+        }
+
+        // Seek is started at the beginning of the step
+        if (m_session.seekTimestamp != -1)
+        {
+            Scheduler::Post([this]() { playbackStep(); });
+            return;
+        }
+
+        /*
+        *   Voice client plays everything it was given before a stop or seek is noticed,
+        *   so only a few seconds are queued ahead: up to high watermark, refilled at low one.
+        */
+        float secondsRemaining = client->get_secs_remaining();
+        if (secondsRemaining >= highWatermark)
+        {
+            schedulePlayback(std::chrono::duration_cast<Scheduler::Clock::duration>(std::chrono::duration<float>(secondsRemaining - lowWatermark)));
+            return;
+        }
+
+        // Waiting for the download would hold the worker from other sessions
+        lock.unlock();
+        bool readable = m_downloader->readable();
+        Downloader::Frame frame;
+        if (readable)
+            frame = m_downloader->extractFrame();
+        lock.lock();
+
+        if (m_playbackStatus == PlaybackStatus::Stopped)
+        {
+            finishPlayback({});
+            return;
+        }
+        if (!readable)
+        {
+            schedulePlayback(PlayerConst::DownloadPollInterval);
+            return;
+        }
+        if (frame.empty())
+        {
+            finishPlayback(Signal::Type::Played);
+            return;
+        }
+
+        // Frame extracted before seeking belongs to the old position
+        if (m_session.seekTimestamp != -1)
+            continue;
+
+/* Temporarily unsupported!
+        if (!m_session.playingVideo->video.chapters().empty())
+        {
+            pt::time_duration currentTimestamp(0, 0, 0, frame.timestamp() * 1'000);
+            if (std::abs((currentTimestamp - m_lastCheckTimestamp).total_seconds()) >= 1)
+            {
+                m_lastCheckTimestamp = currentTimestamp;
+                auto chapterEntry = DeduceChapter(m_session.playingVideo->video.chapters(), currentTimestamp);
+                if (chapterEntry->timestamp != m_lastChapter.timestamp)
+                {
+                    m_lastChapter = *chapterEntry;
+
+                    client = getVoiceClient();
+                    if (!client)
+                    {
+                        finishPlayback({});
+                        return;
+                    }
+                    client->insert_marker(Signal(Signal::Type::ChapterReached, chapterEntry->name));
+                }
+            }
+        }
+*/
+
+        // Voice client might have been destroyed while the frame was extracted
+        client = getVoiceClient();
+        if (!client)
+        {
+            finishPlayback({});
+            return;
+        }
+        if (m_downloader->passthrough())
+            client->send_audio_opus(frame.data(), frame.size(), frame.duration());
+        else
+            client->send_audio_raw(reinterpret_cast<uint16_t*>(frame.data()), frame.size());
+
+        if (!m_firstAudioSent)
+        {
+            m_firstAudioSent = true;
+            m_logger.info("First audio of \"{}\" sent in {:.0f} ms", m_playbackVideoId, m_playbackStopwatch.milliseconds());
+        }
+    }
+
+    // Other sessions get their turn before the buffer is filled further
+    Scheduler::Post([this]() { playbackStep(); });
+}
+
+void Bot::Player::schedulePlayback(Scheduler::Clock::duration delay)
+{
+    m_playbackTimer = Scheduler::Schedule([this]() { playbackStep(); }, delay);
+}
+
+void Bot::Player::wakePlayback()
+{
+    bool waiting = m_playbackTimer && Scheduler::Cancel(m_playbackTimer);
+    m_playbackTimer = 0;
+    if (m_opening)
+    {
+        std::lock_guard openingLock(m_opening->mutex);
+        if (m_opening->onFinished)
+        {
+            m_opening->onFinished = nullptr;
+            waiting = true;
+        }
+    }
+
+    // Step that already left its timer or opener is about to run anyway
+    if (waiting)
+        Scheduler::Post([this]() { playbackStep(); });
+}
+
+void Bot::Player::finishPlayback(std::optional<Signal::Type> signalType)
+{
+    m_downloader.reset();
+    discardPrefetch(m_opening);
+
+    // Cancelled playback leaves no trace in the voice client
+    if (m_playbackStatus == PlaybackStatus::Stopped)
+        signalType.reset();
+
+    dpp::discord_voice_client* client = signalType ? getVoiceClient() : nullptr;
+    if (client)
+    {
+        if (*signalType == Signal::Type::PlayError)
+        {
+            Info info(m_session.guildId);
+            m_root->message_create(info.settings().locale->playError(m_session.playingVideo->video).set_channel_id(m_session.textChannelId));
+        }
+        client->insert_marker(Signal(*signalType, m_playbackVideoId));
+    }
+
+    m_playbackStatus = PlaybackStatus::Idle;
+    m_cv.notify_all();
 }
 
 dpp::discord_voice_client* Bot::Player::getVoiceClient()
@@ -370,35 +616,76 @@ dpp::discord_voice_client* Bot::Player::getVoiceClient()
     return connection->voiceclient;
 }
 
-void Bot::Player::startThread()
+void Bot::Player::startPlayback()
 {
-    if (m_thread.joinable())
-        m_thread.join();
-    m_thread = std::thread(&Player::threadFunction, this);
-}
+    if (m_playbackStatus != PlaybackStatus::Idle || !m_session.playingVideo)
+        return;
 
-void Bot::Player::stopThread(std::unique_lock<std::mutex>& lock)
-{
-    if (m_threadStatus == ThreadStatus::Running)
-        m_threadStatus = ThreadStatus::Stopped;
+    const ytcpp::Video& video = m_session.playingVideo->video;
+    if (video.isLivestream() || video.isUpcoming())
+    {
+        dpp::discord_voice_client* client = getVoiceClient();
+        if (!client)
+            return;
 
-    if (!m_thread.joinable())
+        if (video.isLivestream()) {
+            client->insert_marker(Signal(Signal::Type::LivestreamSkipped, video.id()));
+            m_logger.info("Skipping livestream \"{}\"", video.title());
+        }
+        else if (video.isUpcoming()) {
+            client->insert_marker(Signal(Signal::Type::PremiereSkipped, video.id()));
+            m_logger.info("Skipping premiere \"{}\"", video.title());
+        }
         return;
+    }
 
-    lock.unlock();
-    m_thread.join();
-    lock.lock();
+    m_playbackStatus = PlaybackStatus::Running;
+    m_playbackVideoId = video.id();
+    m_playbackStopwatch.reset();
+    m_firstAudioSent = false;
+    m_timeout.disable();
+
+    // Prefetch may be still in progress: it's still faster to wait for it than to start over
+    if (m_prefetch && m_prefetch->videoId == m_playbackVideoId)
+    {
+        std::lock_guard prefetchLock(m_prefetch->mutex);
+        if (!m_prefetch->finished || m_prefetch->downloader)
+            m_opening = std::move(m_prefetch);
+    }
+    discardPrefetch(m_prefetch);
+    if (!m_opening)
+        m_opening = StartPrefetch(m_session.guildId, m_playbackVideoId);
+
+    Scheduler::Post([this]() { playbackStep(); });
+}
+
+void Bot::Player::stopPlayback(std::unique_lock<std::mutex>& lock)
+{
+    if (m_playbackStatus == PlaybackStatus::Running)
+    {
+        m_playbackStatus = PlaybackStatus::Stopped;
+        wakePlayback();
+    }
+    m_cv.wait(lock, [this]() { return m_playbackStatus == PlaybackStatus::Idle; });
 }
 
 void Bot::Player::signalDisconnect(Locale::EndReason reason)
 {
-    std::thread disconnectThread([this, reason]()
+    /*
+    *   The player may be destroyed before the guild's mutex is acquired,
+    *   and a new session may have started by then: only this session is ended.
+    *   Disconnect runs on the pool, so the bot waits for it when shutting down.
+    */
+    BlockingPool::Post(m_session.guildId, [root = m_root, client = m_client, guildId = m_session.guildId, sessionNumber = m_session.number, reason]()
     {
-        dpp::guild* guild = dpp::find_guild(m_session.guildId);
+        std::lock_guard lock(root->guildMutex(guildId));
+        dpp::guild* guild = dpp::find_guild(guildId);
+        if (!guild)
+            return;
+
         Info info(guild->id);
-        m_root->leaveVoice(m_client, *guild, info, reason);
+        root->leaveVoice(client, *guild, info, reason, sessionNumber);
     });
-    disconnectThread.detach();
 }
 
 void Bot::Player::signalReady(const Info& info)
@@ -406,12 +693,14 @@ void Bot::Player::signalReady(const Info& info)
     std::lock_guard lock(m_mutex);
     if (m_session.startTimestamp.is_not_a_date_time())
     {
+        m_logger.info("Joined voice channel in {:.0f} ms", m_joinStopwatch.milliseconds());
         m_session.startTimestamp = pt::second_clock::local_time();
         if (m_timeout.enabled())
             m_timeout.reset();
         extractNextVideo(info);
         checkPlayingVideo();
         updateStatus(info);
+        publishSession();
     }
     else
     {
@@ -443,12 +732,16 @@ void Bot::Player::signalMarker(const Signal& signal, Info& info)
         incrementPlayedTracks(info);
     checkPlayingVideo();
     updateStatus(info);
+    publishSession();
 }
 
 void Bot::Player::updateTextChannel(dpp::snowflake channelId)
 {
     std::lock_guard lock(m_mutex);
+    if (m_session.textChannelId == channelId)
+        return;
     m_session.textChannelId = channelId;
+    publishSession();
 }
 
 void Bot::Player::updateTimeout(const Info& info)
@@ -463,18 +756,19 @@ void Bot::Player::updateVoiceStatus(const Info& info)
 {
     std::lock_guard lock(m_mutex);
     updateStatus(info);
+    publishSession();
 }
 
 void Bot::Player::updateVoiceServerEndpoint(const std::string& endpoint)
 {
     std::lock_guard lock(m_mutex);
     m_session.voiceServerEndpoint = endpoint;
+    publishSession();
 }
 
-Bot::Session Bot::Player::session()
+std::shared_ptr<const Bot::Session> Bot::Player::session() const
 {
-    std::lock_guard lock(m_mutex);
-    return m_session;
+    return m_sessionSnapshot.load();
 }
 
 void Bot::Player::addItem(const ytcpp::Item& item, const dpp::user& requester, const Info& info)
@@ -482,20 +776,32 @@ void Bot::Player::addItem(const ytcpp::Item& item, const dpp::user& requester, c
     std::unique_lock lock(m_mutex);
     if (!getVoiceClient())
     {
-        m_session.queue.emplace_back(Session::EnqueuedItem{ item, requester });
+        enqueue(item, requester);
+        publishSession();
+
+        // The first video is opened while the voice connection is being established
+        if (!m_session.playingVideo && !m_prefetch)
+        {
+            std::string videoId = nextVideoId();
+            if (!videoId.empty())
+                m_prefetch = StartPrefetch(m_session.guildId, videoId);
+        }
         return;
     }
 
     if (m_session.playingVideo)
     {
-        m_session.queue.emplace_back(Session::EnqueuedItem{ item, requester });
+        enqueue(item, requester);
+        publishSession();
+        updatePrefetch();
         return;
     }
 
-    m_session.queue.emplace_back(Session::EnqueuedItem{ item, requester });
+    enqueue(item, requester);
     extractNextVideo(info);
     updateStatus(info);
-    startThread();
+    publishSession();
+    startPlayback();
 }
 
 bool Bot::Player::paused()
@@ -518,6 +824,7 @@ bool Bot::Player::pauseResume(const Info& info)
     client->pause_audio(isPaused);
     (isPaused ? m_timeout.enable() : m_timeout.disable());
     updateStatus(info);
+    publishSession();
     return isPaused;
 }
 
@@ -537,8 +844,8 @@ void Bot::Player::seek(uint64_t timestamp, const Info& info)
 */
     
     m_session.seekTimestamp = timestamp;
-    if (m_threadStatus != ThreadStatus::Running)
-        startThread();
+    wakePlayback();
+    startPlayback();
 }
 
 void Bot::Player::shuffle()
@@ -547,6 +854,8 @@ void Bot::Player::shuffle()
     static std::random_device randomDevice;
     static std::default_random_engine randomEngine(randomDevice());
     std::shuffle(m_session.queue.begin(), m_session.queue.end(), randomEngine);
+    publishSession();
+    updatePrefetch();
 }
 
 void Bot::Player::skipVideo(Info& info)
@@ -556,13 +865,14 @@ void Bot::Player::skipVideo(Info& info)
     if (!client)
         return;
 
-    stopThread(lock);
+    stopPlayback(lock);
     client->stop_audio();
     incrementPlayedTracks(info);
 
     extractNextVideo(info);
     checkPlayingVideo();
     updateStatus(info);
+    publishSession();
 }
 
 void Bot::Player::skipPlaylist(Info& info)
@@ -572,7 +882,7 @@ void Bot::Player::skipPlaylist(Info& info)
     if (!client)
         return;
 
-    stopThread(lock);
+    stopPlayback(lock);
     client->stop_audio();
     incrementPlayedTracks(info);
 
@@ -580,12 +890,15 @@ void Bot::Player::skipPlaylist(Info& info)
     extractNextVideo(info);
     checkPlayingVideo();
     updateStatus(info);
+    publishSession();
 }
 
 void Bot::Player::clear()
 {
     std::unique_lock lock(m_mutex);
     m_session.queue.clear();
+    publishSession();
+    updatePrefetch();
 }
 
 void Bot::Player::stop(Info& info)
@@ -595,15 +908,17 @@ void Bot::Player::stop(Info& info)
     if (!client)
         return;
 
-    stopThread(lock);
+    stopPlayback(lock);
     client->stop_audio();
     incrementPlayedTracks(info);
 
     m_session.playingVideo.reset();
     m_session.playingPlaylist.reset();
     m_session.queue.clear();
+    discardPrefetch(m_prefetch);
     m_timeout.enable();
     updateStatus(info);
+    publishSession();
 }
 
 void Bot::Player::endSession(Info& info, Locale::EndReason reason)
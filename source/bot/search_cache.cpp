@@ -0,0 +1,129 @@
+#include "bot/search_cache.hpp"
+using namespace kb::Bot::SearchCacheConst;
+
+// STL modules
+#include <exception>
+#include <iterator>
+
+namespace kb {
+
+Bot::SearchCache::Results Bot::SearchCache::find(const std::string& key)
+{
+    auto entry = m_entries.find(key);
+    if (entry == m_entries.end())
+        return {};
+
+    if (Clock::now() >= entry->second.expiration)
+    {
+        m_usage.erase(entry->second.usage);
+        m_entries.erase(entry);
+        return {};
+    }
+
+    m_usage.splice(m_usage.end(), m_usage, entry->second.usage);
+    return entry->second.results;
+}
+
+void Bot::SearchCache::insert(const std::string& key, Results results)
+{
+    const Clock::time_point expiration = Clock::now() + ResultsTtl;
+    auto entry = m_entries.find(key);
+    if (entry != m_entries.end())
+    {
+        entry->second.results = std::move(results);
+        entry->second.expiration = expiration;
+        m_usage.splice(m_usage.end(), m_usage, entry->second.usage);
+        return;
+    }
+
+    while (m_entries.size() >= MaxResults)
+    {
+        m_entries.erase(m_usage.front());
+        m_usage.pop_front();
+    }
+
+    m_usage.push_back(key);
+    m_entries.emplace(key, Entry{ std::move(results), expiration, std::prev(m_usage.end()) });
+}
+
+Bot::SearchCache::Results Bot::SearchCache::get(const std::string& key, const std::function<ytcpp::SearchResults()>& search)
+{
+    std::promise<Results> promise;
+    std::unique_lock lock(m_mutex);
+    if (Results results = find(key))
+        return results;
+
+    auto pendingSearch = m_pendingSearches.find(key);
+    if (pendingSearch != m_pendingSearches.end())
+    {
+        std::shared_future<Results> future = pendingSearch->second;
+        lock.unlock();
+        return future.get();
+    }
+
+    m_pendingSearches.emplace(key, promise.get_future().share());
+    lock.unlock();
+
+    // Searching waits for YouTube, so it's done unlocked. Failures aren't cached.
+    Results results;
+    try
+    {
+        results = std::make_shared<const ytcpp::SearchResults>(search());
+    }
+    catch (...)
+    {
+        lock.lock();
+        m_pendingSearches.erase(key);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    lock.lock();
+    insert(key, results);
+    m_pendingSearches.erase(key);
+    lock.unlock();
+    promise.set_value(results);
+    return results;
+}
+
+std::string Bot::SearchCache::NormalizeQuery(std::string_view query)
+{
+    std::string normalized;
+    normalized.reserve(query.size());
+    bool space = false;
+    for (char character : query)
+    {
+        if (character == ' ' || character == '\t' || character == '\n' || character == '\r')
+        {
+            space = !normalized.empty();
+            continue;
+        }
+
+        if (space)
+        {
+            normalized += ' ';
+            space = false;
+        }
+        normalized += (character >= 'A' && character <= 'Z' ? static_cast<char>(character - 'A' + 'a') : character);
+    }
+    return normalized;
+}
+
+Bot::SearchCache::Results Bot::SearchCache::QuerySearch(const std::string& query)
+{
+    return Instance().get("query:" + NormalizeQuery(query), [&query]()
+    {
+        return ytcpp::QuerySearch(query);
+    });
+}
+
+Bot::SearchCache::Results Bot::SearchCache::RelatedSearch(const std::string& videoId)
+{
+    return Instance().get("related:" + videoId, [&videoId]()
+    {
+        return ytcpp::RelatedSearch(videoId);
+    });
+}
+
+} // namespace kb
@@ -3,11 +3,11 @@
 namespace kb {
 
 Bot::Timeout::Timeout(const Callback& callback, uint64_t timeoutDuration)
-    : m_enabled(true)
+    : m_timeoutDuration(timeoutDuration)
+    , m_timerId(0)
     , m_callback(callback)
-    , m_timeoutDuration(timeoutDuration)
 {
-    m_thread = std::thread(&Timeout::threadFunction, this);
+    enable();
 }
 
 Bot::Timeout::Timeout(const Timeout& other)
@@ -17,18 +17,17 @@ Bot::Timeout::Timeout(const Timeout& other)
 Bot::Timeout::~Timeout()
 {
     disable();
-    if (m_thread.joinable())
-        m_thread.join();
 }
 
-void Bot::Timeout::threadFunction()
+void Bot::Timeout::expire()
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-    bool timeouted = !m_cv.wait_for(lock, std::chrono::seconds(m_timeoutDuration), [this]() { return !m_enabled; });
-    m_enabled = false;
-
-    if (timeouted)
-        m_callback();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_timerId)
+            return; // Disabled while the timer was expiring
+        m_timerId = 0;
+    }
+    m_callback();
 }
 
 void Bot::Timeout::setTimeoutDuration(uint64_t timeoutDuration)
@@ -40,40 +39,47 @@ void Bot::Timeout::setTimeoutDuration(uint64_t timeoutDuration)
 bool Bot::Timeout::enabled() const
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_enabled;
+    return m_timerId != 0;
 }
 
 void Bot::Timeout::enable()
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    if (m_enabled)
+    if (m_timerId)
         return;
 
-    if (m_thread.joinable())
-        m_thread.join();
-
-    m_enabled = true;
-    m_thread = std::thread(&Timeout::threadFunction, this);
+    m_timerId = TimerWheel::Arm([this]() { expire(); }, std::chrono::seconds(m_timeoutDuration));
 }
 
 void Bot::Timeout::disable()
 {
+    TimerWheel::TimerId timerId;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        if (!m_enabled)
-            return;
-
-        m_enabled = false;
-        m_cv.notify_one();
+        timerId = m_timerId;
+        m_timerId = 0;
     }
 
-    if (m_thread.joinable())
-        m_thread.join();
+    // Expiring timer's callback locks the mutex, so it must not be held while waiting for it
+    if (timerId)
+        TimerWheel::Cancel(timerId);
 }
 
 void Bot::Timeout::reset()
 {
-    disable();
+    TimerWheel::TimerId expiredTimerId;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_timerId && TimerWheel::Reset(m_timerId, std::chrono::seconds(m_timeoutDuration)))
+            return;
+
+        // Timer that has already expired must not call the callback anymore
+        expiredTimerId = m_timerId;
+        m_timerId = 0;
+    }
+
+    if (expiredTimerId)
+        TimerWheel::Cancel(expiredTimerId);
     enable();
 }
 
@@ -36,6 +36,16 @@ Bot::Stats& Bot::Stats::operator+=(const Stats& other)
     return *this;
 }
 
+Bot::Stats& Bot::Stats::operator-=(const Stats& other)
+{
+    interactionsProcessed -= other.interactionsProcessed;
+    sessionsConducted -= other.sessionsConducted;
+    tracksPlayed -= other.tracksPlayed;
+    timesKicked -= other.timesKicked;
+    timesMoved -= other.timesMoved;
+    return *this;
+}
+
 bool Bot::Stats::operator==(const Stats& other) const
 {
     return interactionsProcessed == other.interactionsProcessed
@@ -0,0 +1,220 @@
+#include "core/blocking_pool.hpp"
+using namespace kb::BlockingPoolConst;
+
+// STL modules
+#include <algorithm>
+
+// Custom modules
+#include "core/utility.hpp"
+
+namespace kb {
+
+BlockingPool::BlockingPool()
+    : m_logger(Utility::CreateLogger("blocking pool"))
+    , m_stopped(false)
+    , m_metricsTimer(0)
+{
+    m_interactive.maxQueuedTasks = MaxQueuedTasks;
+    m_interactive.maxQueuedKeyTasks = MaxQueuedKeyTasks;
+    m_background.maxQueuedTasks = MaxQueuedBackgroundTasks;
+    m_background.maxQueuedKeyTasks = MaxQueuedBackgroundKeyTasks;
+    startLane(m_interactive, Workers);
+    startLane(m_background, BackgroundWorkers);
+
+    std::lock_guard lock(m_mutex);
+    m_metricsTimer = Scheduler::Schedule([this]() { reportMetrics(); }, MetricsInterval);
+}
+
+BlockingPool::~BlockingPool()
+{
+    stop();
+}
+
+BlockingPool::Lane& BlockingPool::lane(Priority priority)
+{
+    return priority == Priority::Interactive ? m_interactive : m_background;
+}
+
+void BlockingPool::startLane(Lane& lane, size_t workers)
+{
+    for (size_t index = 0; index < workers; ++index)
+        lane.threads.emplace_back(&BlockingPool::threadFunction, this, std::ref(lane));
+}
+
+void BlockingPool::threadFunction(Lane& lane)
+{
+    std::unique_lock lock(m_mutex);
+    while (true)
+    {
+        lane.cv.wait(lock, [this, &lane]() { return m_stopped || !lane.readyKeys.empty(); });
+        if (m_stopped)
+            return;
+
+        // The key goes to the back of the line if it has more tasks
+        uint64_t key = lane.readyKeys.front();
+        lane.readyKeys.pop_front();
+        auto queue = lane.queues.find(key);
+        QueuedTask queuedTask = std::move(queue->second.front());
+        queue->second.pop_front();
+        if (queue->second.empty())
+            lane.queues.erase(queue);
+        else
+            lane.readyKeys.push_back(key);
+
+        Clock::duration wait = Clock::now() - queuedTask.submitTime;
+        --lane.queuedTasks;
+        ++lane.runningTasks;
+        ++lane.startedTasks;
+        lane.totalWait += wait;
+        lane.maxWait = std::max(lane.maxWait, wait);
+
+        lock.unlock();
+        try
+        {
+            queuedTask.task();
+        }
+        catch (const std::exception& error)
+        {
+            m_logger.error("Task failed: {}", error.what());
+        }
+        catch (...)
+        {
+            m_logger.error("Task failed: Unknown error");
+        }
+        queuedTask.task = nullptr;
+        lock.lock();
+
+        --lane.runningTasks;
+    }
+}
+
+void BlockingPool::stop()
+{
+    // Discarded tasks are destroyed unlocked: they may own resources that take locks when released
+    std::vector<std::unordered_map<uint64_t, std::deque<QueuedTask>>> discardedQueues;
+    Scheduler::TimerId metricsTimer;
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopped = true;
+        for (Lane* stoppedLane : { &m_interactive, &m_background })
+        {
+            discardedQueues.push_back(std::move(stoppedLane->queues));
+            stoppedLane->queues.clear();
+            stoppedLane->readyKeys.clear();
+            stoppedLane->queuedTasks = 0;
+            stoppedLane->cv.notify_all();
+        }
+        metricsTimer = m_metricsTimer;
+        m_metricsTimer = 0;
+    }
+
+    if (metricsTimer)
+        Scheduler::Cancel(metricsTimer);
+    for (Lane* stoppedLane : { &m_interactive, &m_background })
+    {
+        for (std::thread& thread : stoppedLane->threads)
+        {
+            if (thread.joinable())
+                thread.join();
+        }
+    }
+}
+
+void BlockingPool::reportMetrics()
+{
+    std::lock_guard lock(m_mutex);
+    if (m_stopped)
+        return;
+
+    reportLaneMetrics(m_interactive, "Interactive");
+    reportLaneMetrics(m_background, "Background");
+    m_metricsTimer = Scheduler::Schedule([this]() { reportMetrics(); }, MetricsInterval);
+}
+
+void BlockingPool::reportLaneMetrics(Lane& lane, const char* name)
+{
+    if (lane.acceptedTasks != 0 || lane.rejectedTasks != 0)
+    {
+        Metrics current = LaneMetrics(lane);
+        m_logger.info(
+            "{} tasks accepted: {}, rejected: {}, waiting: {}, running: {}, average wait: {} ms, max wait: {} ms",
+            name, current.acceptedTasks, current.rejectedTasks, current.queuedTasks, current.runningTasks,
+            std::chrono::duration_cast<std::chrono::milliseconds>(current.averageWait).count(),
+            std::chrono::duration_cast<std::chrono::milliseconds>(current.maxWait).count()
+        );
+    }
+
+    lane.acceptedTasks = 0;
+    lane.rejectedTasks = 0;
+    lane.startedTasks = 0;
+    lane.totalWait = Clock::duration::zero();
+    lane.maxWait = Clock::duration::zero();
+}
+
+bool BlockingPool::enqueue(Lane& lane, uint64_t key, Task& task, bool bounded)
+{
+    std::deque<QueuedTask>& queue = lane.queues[key];
+    if (m_stopped || (bounded && (lane.queuedTasks >= lane.maxQueuedTasks || queue.size() >= lane.maxQueuedKeyTasks)))
+    {
+        if (queue.empty())
+            lane.queues.erase(key);
+        ++lane.rejectedTasks;
+        return false;
+    }
+
+    if (queue.empty())
+        lane.readyKeys.push_back(key);
+    queue.push_back({ std::move(task), Clock::now() });
+    ++lane.queuedTasks;
+    ++lane.acceptedTasks;
+    lane.cv.notify_one();
+    return true;
+}
+
+BlockingPool::Metrics BlockingPool::LaneMetrics(const Lane& lane)
+{
+    Metrics metrics;
+    metrics.queuedTasks = lane.queuedTasks;
+    metrics.runningTasks = lane.runningTasks;
+    metrics.acceptedTasks = lane.acceptedTasks;
+    metrics.rejectedTasks = lane.rejectedTasks;
+    if (lane.startedTasks != 0)
+        metrics.averageWait = lane.totalWait / static_cast<Clock::rep>(lane.startedTasks);
+    metrics.maxWait = lane.maxWait;
+    return metrics;
+}
+
+bool BlockingPool::Submit(uint64_t key, Task task)
+{
+    BlockingPool& pool = Instance();
+    std::lock_guard lock(pool.m_mutex);
+    return pool.enqueue(pool.m_interactive, key, task, true);
+}
+
+bool BlockingPool::Defer(uint64_t key, Task task)
+{
+    BlockingPool& pool = Instance();
+    std::lock_guard lock(pool.m_mutex);
+    return pool.enqueue(pool.m_background, key, task, true);
+}
+
+bool BlockingPool::Post(uint64_t key, Task task)
+{
+    BlockingPool& pool = Instance();
+    std::lock_guard lock(pool.m_mutex);
+    return pool.enqueue(pool.m_background, key, task, false);
+}
+
+BlockingPool::Metrics BlockingPool::GetMetrics(Priority priority)
+{
+    BlockingPool& pool = Instance();
+    std::lock_guard lock(pool.m_mutex);
+    return LaneMetrics(pool.lane(priority));
+}
+
+void BlockingPool::Stop()
+{
+    Instance().stop();
+}
+
+} // namespace kb
@@ -0,0 +1,302 @@
+#include "core/cache.hpp"
+using namespace kb::CacheConst;
+
+// STL modules
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+// Library nlohmann/json
+#include <nlohmann/json.hpp>
+
+// Library {fmt}
+#include <fmt/format.h>
+
+// Custom modules
+#include "core/config.hpp"
+#include "core/error.hpp"
+#include "core/io.hpp"
+#include "core/utility.hpp"
+
+namespace kb {
+
+/* Namespace aliases and imports */
+using nlohmann::json;
+namespace fs = std::filesystem;
+
+Cache::PartFile::PartFile(const std::string& videoId)
+    : m_videoId(videoId)
+{
+    std::string fileName = fmt::format("{}.{}{}", videoId, Utility::RandomNumber(0, 999'999), PartExtension);
+    if (Cache::Enabled())
+        m_path = fmt::format("{}/{}", Config::CacheDirectory(), fileName);
+    else
+        m_path = (fs::temp_directory_path() / (SpoolPrefix + fileName)).string();
+    m_file.open(m_path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+}
+
+Cache::PartFile::~PartFile()
+{
+    if (m_path.empty())
+        return;
+
+    // The file wasn't committed: it is incomplete
+    m_file.close();
+    std::error_code error;
+    fs::remove(m_path, error);
+}
+
+bool Cache::PartFile::write(uint64_t position, const uint8_t* data, size_t length)
+{
+    if (!m_file || m_path.empty())
+        return false;
+
+    m_file.seekp(position);
+    m_file.write(reinterpret_cast<const char*>(data), length);
+    if (!m_file)
+        return false;
+
+    m_ranges.insert(position, position + length);
+    return true;
+}
+
+size_t Cache::PartFile::read(uint64_t position, uint8_t* data, size_t length)
+{
+    uint64_t bytesWritten = m_ranges.rangeEnd(position) - position;
+    if (!m_file || !bytesWritten)
+        return 0;
+
+    m_file.seekg(position);
+    m_file.read(reinterpret_cast<char*>(data), std::min<uint64_t>(length, bytesWritten));
+    size_t bytesRead = static_cast<size_t>(m_file.gcount());
+    m_file.clear();
+    return bytesRead;
+}
+
+bool Cache::PartFile::committable(uint64_t fileSize) const
+{
+    return !m_path.empty() && Cache::Enabled() && m_ranges.covers(0, fileSize) && m_ranges.size() == fileSize;
+}
+
+void Cache::PartFile::commit(uint64_t fileSize)
+{
+    if (!committable(fileSize))
+        return;
+
+    m_file.close();
+    if (!m_file)
+        return;
+
+    // Reading continues from the cached file
+    std::string path = Instance().insert(m_videoId, m_path, fileSize);
+    m_path.clear();
+    if (!path.empty())
+        m_file.open(path, std::ios::binary | std::ios::in);
+    if (!m_file.is_open())
+    {
+        m_ranges.clear();
+        m_file.setstate(std::ios::failbit);
+    }
+}
+
+Cache::Cache()
+    : m_logger(Utility::CreateLogger("cache"))
+    , m_directory(Config::CacheDirectory())
+    , m_maxSize(Config::CacheMaxSize())
+    , m_size(0)
+    , m_indexDirty(false)
+{
+    if (!m_maxSize)
+        return;
+
+    std::error_code error;
+    fs::create_directories(m_directory, error);
+    if (error)
+    {
+        m_logger.error("Couldn't create cache directory \"{}\", caching is disabled: {}", m_directory, error.message());
+        m_maxSize = 0;
+        return;
+    }
+
+    /*
+    *   Index lists cached files from the most to the least recently used.
+    *   Files that exist but are not in the index are treated as the least recently used.
+    *   Missing or corrupted index is not an error: the directory contents are the source of truth.
+    */
+    try
+    {
+        json indexJson = json::parse(IO::ReadFile(fmt::format("{}/{}", m_directory, IndexFile)));
+        for (const json& entryJson : indexJson.at(Fields::Entries))
+        {
+            std::string videoId = entryJson.at(Fields::Id);
+            uint64_t size = entryJson.at(Fields::Size);
+            if (m_entries.contains(videoId) || fs::file_size(filePath(videoId), error) != size || error)
+                continue;
+
+            m_order.push_back(videoId);
+            m_entries[videoId] = { size, std::prev(m_order.end()) };
+            m_size += size;
+        }
+    }
+    catch (...)
+    {
+        m_logger.warn("Couldn't load cache index, rebuilding it from directory contents");
+    }
+
+    for (const fs::directory_entry& file : fs::directory_iterator(m_directory, error))
+    {
+        std::string extension = file.path().extension().string();
+        if (extension == PartExtension)
+        {
+            // Leftover of interrupted download
+            fs::remove(file.path(), error);
+            continue;
+        }
+
+        std::string videoId = file.path().stem().string();
+        if (extension != FileExtension || m_entries.contains(videoId))
+            continue;
+
+        uint64_t size = file.file_size(error);
+        if (error)
+            continue;
+
+        m_order.push_back(videoId);
+        m_entries[videoId] = { size, std::prev(m_order.end()) };
+        m_size += size;
+    }
+
+    evict();
+    saveIndex();
+    m_logger.info("{} cached file{} [{} / {} MiB]", m_entries.size(), m_entries.size() == 1 ? "" : "s", m_size / 1024 / 1024, m_maxSize / 1024 / 1024);
+}
+
+Cache::~Cache()
+{
+    std::lock_guard lock(m_mutex);
+    if (m_indexDirty)
+        saveIndex();
+}
+
+std::string Cache::filePath(const std::string& videoId) const
+{
+    return fmt::format("{}/{}{}", m_directory, videoId, FileExtension);
+}
+
+void Cache::saveIndex()
+{
+    json entriesJson = json::array();
+    for (const std::string& videoId : m_order)
+    {
+        json entryJson;
+        entryJson[Fields::Id] = videoId;
+        entryJson[Fields::Size] = m_entries[videoId].size;
+        entriesJson.push_back(entryJson);
+    }
+
+    json indexJson;
+    indexJson[Fields::Entries] = entriesJson;
+
+    // Renaming is atomic: index file is never seen half-written
+    std::string indexPath = fmt::format("{}/{}", m_directory, IndexFile);
+    std::string temporaryPath = indexPath + ".tmp";
+    try
+    {
+        IO::WriteFile(temporaryPath, indexJson.dump() + '\n');
+    }
+    catch (const Error& error)
+    {
+        m_logger.error("Couldn't save cache index: {}", error.what());
+        return;
+    }
+
+    std::error_code error;
+    fs::rename(temporaryPath, indexPath, error);
+    if (error)
+    {
+        m_logger.error("Couldn't save cache index: {}", error.message());
+        return;
+    }
+    m_indexDirty = false;
+}
+
+void Cache::evict()
+{
+    while (m_size > m_maxSize && !m_order.empty())
+    {
+        std::string videoId = m_order.back();
+        std::error_code error;
+        fs::remove(filePath(videoId), error);
+
+        m_size -= m_entries[videoId].size;
+        m_entries.erase(videoId);
+        m_order.pop_back();
+        m_logger.info("Evicted \"{}\"", videoId);
+    }
+}
+
+std::string Cache::insert(const std::string& videoId, const std::string& partPath, uint64_t size)
+{
+    std::lock_guard lock(m_mutex);
+    std::string path = filePath(videoId);
+    std::error_code error;
+    fs::rename(partPath, path, error);
+    if (error)
+    {
+        m_logger.error("Couldn't add \"{}\" to cache: {}", videoId, error.message());
+        fs::remove(partPath, error);
+        return {};
+    }
+
+    auto entry = m_entries.find(videoId);
+    if (entry != m_entries.end())
+    {
+        m_size -= entry->second.size;
+        m_order.erase(entry->second.order);
+        m_entries.erase(entry);
+    }
+
+    m_order.push_front(videoId);
+    m_entries[videoId] = { size, m_order.begin() };
+    m_size += size;
+    m_logger.info("Added \"{}\" [{} KiB]", videoId, size / 1024);
+
+    evict();
+    saveIndex();
+    return path;
+}
+
+bool Cache::Enabled()
+{
+    return Instance().m_maxSize != 0;
+}
+
+std::string Cache::Lookup(const std::string& videoId)
+{
+    Cache& cache = Instance();
+    if (!cache.m_maxSize)
+        return {};
+
+    std::lock_guard lock(cache.m_mutex);
+    auto entry = cache.m_entries.find(videoId);
+    if (entry == cache.m_entries.end())
+        return {};
+
+    std::string path = cache.filePath(videoId);
+    if (!fs::is_regular_file(path))
+    {
+        // File was deleted from outside
+        cache.m_size -= entry->second.size;
+        cache.m_order.erase(entry->second.order);
+        cache.m_entries.erase(entry);
+        cache.m_indexDirty = true;
+        return {};
+    }
+
+    // Recency is only saved with the next insertion or at exit, so starting a track doesn't write to disk
+    cache.m_order.splice(cache.m_order.begin(), cache.m_order, entry->second.order);
+    cache.m_indexDirty = true;
+    return path;
+}
+
+} // namespace kb
@@ -17,6 +17,24 @@ namespace Objects {
         constexpr const char* Enabled = "enabled";
         constexpr const char* Url = "url";
     }
+
+    namespace Downloader {
+        constexpr const char* Object = "downloader";
+        constexpr const char* LookBehind = "look_behind_kib";
+        constexpr const char* LookAhead = "look_ahead_kib";
+    }
+
+    namespace Player {
+        constexpr const char* Object = "player";
+        constexpr const char* LowWatermark = "low_watermark_ms";
+        constexpr const char* HighWatermark = "high_watermark_ms";
+    }
+
+    namespace Cache {
+        constexpr const char* Object = "cache";
+        constexpr const char* Directory = "directory";
+        constexpr const char* MaxSize = "max_size_mib";
+    }
 }
 
 namespace Defaults {
@@ -27,6 +45,21 @@ namespace Defaults {
         constexpr bool Enabled = false;
         constexpr const char* Url = "Enter proxy URL here";
     }
+
+    namespace Downloader {
+        constexpr size_t LookBehind = 256;
+        constexpr size_t LookAhead = 2048;
+    }
+
+    namespace Player {
+        constexpr uint64_t LowWatermark = 1000;
+        constexpr uint64_t HighWatermark = 3000;
+    }
+
+    namespace Cache {
+        constexpr const char* Directory = "cache";
+        constexpr uint64_t MaxSize = 1024;
+    }
 }
 
 void Config::GenerateSampleFile() {
@@ -34,13 +67,34 @@ void Config::GenerateSampleFile() {
     proxyObject[Objects::Proxy::Enabled] = Defaults::Proxy::Enabled;
     proxyObject[Objects::Proxy::Url] = Defaults::Proxy::Url;
 
+    json downloaderObject;
+    downloaderObject[Objects::Downloader::LookBehind] = Defaults::Downloader::LookBehind;
+    downloaderObject[Objects::Downloader::LookAhead] = Defaults::Downloader::LookAhead;
+
+    json playerObject;
+    playerObject[Objects::Player::LowWatermark] = Defaults::Player::LowWatermark;
+    playerObject[Objects::Player::HighWatermark] = Defaults::Player::HighWatermark;
+
+    json cacheObject;
+    cacheObject[Objects::Cache::Directory] = Defaults::Cache::Directory;
+    cacheObject[Objects::Cache::MaxSize] = Defaults::Cache::MaxSize;
+
     json configJson;
     configJson[Objects::DiscordBotApiToken] = Defaults::DiscordBotApiToken;
     configJson[Objects::Proxy::Object] = proxyObject;
+    configJson[Objects::Downloader::Object] = downloaderObject;
+    configJson[Objects::Player::Object] = playerObject;
+    configJson[Objects::Cache::Object] = cacheObject;
     IO::WriteFile(Filename, configJson.dump(4) + '\n');
 }
 
-Config::Config() {
+Config::Config()
+    : m_downloaderLookBehind(Defaults::Downloader::LookBehind * 1024)
+    , m_downloaderLookAhead(Defaults::Downloader::LookAhead * 1024)
+    , m_playerLowWatermark(Defaults::Player::LowWatermark)
+    , m_playerHighWatermark(Defaults::Player::HighWatermark)
+    , m_cacheDirectory(Defaults::Cache::Directory)
+    , m_cacheMaxSize(Defaults::Cache::MaxSize * 1024 * 1024) {
     std::string fileContents;
     try {
         fileContents = IO::ReadFile(Filename);
@@ -57,6 +111,29 @@ Config::Config() {
         const json& proxyObject = configJson.at(Objects::Proxy::Object);
         m_proxyEnabled = proxyObject.at(Objects::Proxy::Enabled);
         m_proxyUrl = proxyObject.at(Objects::Proxy::Url);
+
+        // Downloader configuration is optional: older config files don't have it
+        if (configJson.contains(Objects::Downloader::Object)) {
+            const json& downloaderObject = configJson.at(Objects::Downloader::Object);
+            m_downloaderLookBehind = downloaderObject.at(Objects::Downloader::LookBehind).get<size_t>() * 1024;
+            m_downloaderLookAhead = downloaderObject.at(Objects::Downloader::LookAhead).get<size_t>() * 1024;
+        }
+
+        if (configJson.contains(Objects::Player::Object)) {
+            const json& playerObject = configJson.at(Objects::Player::Object);
+            m_playerLowWatermark = playerObject.at(Objects::Player::LowWatermark);
+            m_playerHighWatermark = playerObject.at(Objects::Player::HighWatermark);
+            if (m_playerLowWatermark > m_playerHighWatermark) {
+                m_error = "Player low watermark is higher than high watermark";
+                return;
+            }
+        }
+
+        if (configJson.contains(Objects::Cache::Object)) {
+            const json& cacheObject = configJson.at(Objects::Cache::Object);
+            m_cacheDirectory = cacheObject.at(Objects::Cache::Directory);
+            m_cacheMaxSize = cacheObject.at(Objects::Cache::MaxSize).get<uint64_t>() * 1024 * 1024;
+        }
     }
     catch (const json::exception&) {
         m_error = "Couldn't parse config file JSON";
@@ -3,7 +3,15 @@ using namespace kb::DownloaderConst;
 
 // STL modules
 #include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <stdexcept>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // SSE2 intrinsics
+    #include <emmintrin.h>
+#endif
 
 // Library Boost.Regex
 #include <boost/regex.hpp>
@@ -18,9 +26,10 @@ using namespace kb::DownloaderConst;
 #include <fmt/format.h>
 
 // Custom modules
+#include "core/blocking_pool.hpp"
 #include "core/config.hpp"
+#include "core/format_cache.hpp"
 #include "core/utility.hpp"
-#include "ytcpp/format.hpp"
 #include "ytcpp/utility.hpp"
 
 namespace kb {
@@ -28,73 +37,298 @@ namespace kb {
 /* Namespace aliases and imports */
 using nlohmann::json;
 
+/// @brief Check if container header describes an audio stream well enough to open its decoder
+/// @param format Opened format context
+/// @return True if stream info doesn't need to be probed
+static bool HeaderDescribesAudio(const AVFormatContext* format)
+{
+    for (unsigned int index = 0; index < format->nb_streams; ++index)
+    {
+        const AVCodecParameters* parameters = format->streams[index]->codecpar;
+        if (parameters->codec_type == AVMEDIA_TYPE_AUDIO && parameters->codec_id != AV_CODEC_ID_NONE
+            && parameters->sample_rate > 0 && parameters->ch_layout.nb_channels > 0)
+            return true;
+    }
+    return false;
+}
+
+/// @brief Convert planar float stereo samples to interleaved 16 bit ones
+/// @param left Left channel samples
+/// @param right Right channel samples
+/// @param output Buffer to write interleaved samples to
+/// @param sampleCount Count of samples per channel
+static void ConvertSamples(const float* left, const float* right, int16_t* output, int sampleCount)
+{
+    int sampleIndex = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    // SSE2 is always available on x86-64: 8 samples per channel at once, saturated when packed
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    for (; sampleIndex + 8 <= sampleCount; sampleIndex += 8)
+    {
+        __m128i leftSamples = _mm_packs_epi32(
+            _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(left + sampleIndex), scale)),
+            _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(left + sampleIndex + 4), scale))
+        );
+        __m128i rightSamples = _mm_packs_epi32(
+            _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(right + sampleIndex), scale)),
+            _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(right + sampleIndex + 4), scale))
+        );
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + sampleIndex * 2), _mm_unpacklo_epi16(leftSamples, rightSamples));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(output + sampleIndex * 2 + 8), _mm_unpackhi_epi16(leftSamples, rightSamples));
+    }
+#endif
+
+    for (; sampleIndex < sampleCount; ++sampleIndex)
+    {
+        output[sampleIndex * 2] = static_cast<int16_t>(std::clamp(std::lrintf(left[sampleIndex] * 32768.0f), -32768l, 32767l));
+        output[sampleIndex * 2 + 1] = static_cast<int16_t>(std::clamp(std::lrintf(right[sampleIndex] * 32768.0f), -32768l, 32767l));
+    }
+}
+
 Downloader::Frame::Frame()
-    : m_timestamp(-1)
+    : m_data(FramePool::Acquire())
+    , m_size(0)
+    , m_timestamp(-1)
+    , m_duration(0)
 {}
 
+Downloader::Frame::Frame(Frame&& other) noexcept
+    : m_data(std::move(other.m_data))
+    , m_size(std::exchange(other.m_size, 0))
+    , m_timestamp(other.m_timestamp)
+    , m_duration(other.m_duration)
+{}
+
+Downloader::Frame& Downloader::Frame::operator=(Frame&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    FramePool::Release(std::move(m_data));
+    m_data = std::move(other.m_data);
+    m_size = std::exchange(other.m_size, 0);
+    m_timestamp = other.m_timestamp;
+    m_duration = other.m_duration;
+    return *this;
+}
+
+Downloader::Frame::~Frame()
+{
+    FramePool::Release(std::move(m_data));
+}
+
 void Downloader::Frame::clear()
 {
+    m_size = 0;
     m_timestamp = -1;
-    vector::clear();
+    m_duration = 0;
 }
 
-int Downloader::ProgressCallback(Downloader* target, double downloadTotal, double downloadNow, double uploadTotal, double uploadNow)
+bool Downloader::Frame::assign(const uint8_t* data, size_t size)
 {
-    std::lock_guard lock(target->m_mutex);
-    return static_cast<int>(target->m_threadStatus == ThreadStatus::Stopped);
+    // Truncated packet would be sent as corrupted audio
+    if (size > capacity())
+        return false;
+
+    m_size = size;
+    std::copy(data, data + size, m_data.get());
+    return true;
+}
+
+Downloader::ChunkTransfer::ChunkTransfer(Downloader* downloader)
+    : downloader(downloader)
+    , curl(nullptr, TransferEngine::Release)
+    , start(0)
+    , position(0)
+    , end(0)
+    , running(false)
+{}
+
+Downloader::PartFileCommit::PartFileCommit(Downloader* downloader, std::unique_ptr<Cache::PartFile> partFile, uint64_t fileSize)
+    : downloader(downloader)
+    , partFile(std::move(partFile))
+    , fileSize(fileSize)
+{}
+
+Downloader::PartFileCommit::~PartFileCommit()
+{
+    if (partFile)
+        giveBack();
+}
+
+void Downloader::PartFileCommit::run()
+{
+    partFile->commit(fileSize);
+    giveBack();
+}
+
+void Downloader::PartFileCommit::giveBack()
+{
+    std::lock_guard lock(downloader->m_mutex);
+    if (partFile->good())
+        downloader->m_partFile = std::move(partFile);
+    partFile.reset();
+    downloader->m_partFileCommitting = false;
+    downloader->m_cv.notify_all();
 }
 
 size_t Downloader::HeaderWriter(uint8_t* data, size_t itemSize, size_t itemCount, Downloader* target)
 {
     std::lock_guard lock(target->m_mutex);
-    if (!target->m_fileSize)
-    {
-        std::string string(reinterpret_cast<char*>(data), itemCount);
-        boost::smatch matches;
-        if (boost::regex_search(string, matches, boost::regex(R"([Cc]ontent-[Ll]ength: (\d+))")))
-            target->m_fileSize = std::stoull(matches.str(1));
-    }
+    std::string string(reinterpret_cast<char*>(data), itemCount);
+    boost::smatch matches;
+
+    // Range responses carry total size in Content-Range, Content-Length is the size of the range
+    if (boost::regex_search(string, matches, boost::regex(R"([Cc]ontent-[Rr]ange: bytes \d+-\d+/(\d+))")))
+        target->m_fileSize = std::stoull(matches.str(1));
+    else if (!target->m_fileSize && boost::regex_search(string, matches, boost::regex(R"([Cc]ontent-[Ll]ength: (\d+))")))
+        target->m_fileSize = std::stoull(matches.str(1));
     return itemSize * itemCount;
 }
 
 size_t Downloader::DownloaderWriter(uint8_t* data, size_t itemSize, size_t itemCount, Downloader* target)
 {
     std::lock_guard lock(target->m_mutex);
-    target->m_buffer.insert(target->m_buffer.end(), data, data + itemCount);
+    size_t bytesTotal = itemSize * itemCount;
+
+    // Returning less than requested makes curl abort the transfer
+    if (target->m_transferStatus == TransferStatus::Stopped)
+        return 0;
+
+    if (target->m_firstChunk)
+    {
+        // Connect time stays zero when connection and TLS session were reused
+        curl_off_t firstByteTime = 0;
+        curl_off_t connectTime = 0;
+        curl_easy_getinfo(target->m_curl.get(), CURLINFO_STARTTRANSFER_TIME_T, &firstByteTime);
+        curl_easy_getinfo(target->m_curl.get(), CURLINFO_APPCONNECT_TIME_T, &connectTime);
+        target->m_logger.info("First byte received in {} ms ({} connection)", firstByteTime / 1000, connectTime ? "new" : "reused");
+        target->m_firstChunk = false;
+    }
+
+    /*
+    *   Callback runs on the shared transfer engine thread and must not block.
+    *   Paused transfer delivers the same data again once resumed, so it is pushed whole or not at all.
+    */
+    target->trimWindow();
+    if (target->m_window.free() < bytesTotal)
+    {
+        target->m_transferPaused = true;
+        target->m_transferWasPaused = true;
+        return CURL_WRITEFUNC_PAUSE;
+    }
+
+    if (target->m_partFile && !target->m_partFile->write(target->windowEnd(), data, bytesTotal))
+        target->m_partFile.reset();
+    target->m_window.push(data, bytesTotal);
     target->m_cv.notify_all();
-    return itemSize * itemCount;
+    return bytesTotal;
+}
+
+size_t Downloader::ChunkWriter(uint8_t* data, size_t itemSize, size_t itemCount, ChunkTransfer* target)
+{
+    Downloader* downloader = target->downloader;
+    std::lock_guard lock(downloader->m_mutex);
+    size_t bytesTotal = itemSize * itemCount;
+
+    // Returning less than requested makes curl abort the transfer
+    if (downloader->m_transferStatus == TransferStatus::Stopped || !downloader->m_partFile)
+        return 0;
+
+    // Server may ignore the range and send the whole file
+    long responseCode = 0;
+    curl_easy_getinfo(target->curl.get(), CURLINFO_RESPONSE_CODE, &responseCode);
+    if (responseCode != 206)
+        return 0;
+
+    size_t bytesWanted = static_cast<size_t>(std::min<uint64_t>(bytesTotal, target->end - target->position));
+    if (!downloader->m_partFile->write(target->position, data, bytesWanted))
+    {
+        downloader->m_partFile.reset();
+        return 0;
+    }
+
+    target->position += bytesWanted;
+    downloader->m_cv.notify_all();
+    return bytesWanted == bytesTotal ? bytesTotal : 0;
 }
 
 int Downloader::Read(void* root, uint8_t* buffer, int bufferLength)
 {
     Downloader* extractor = reinterpret_cast<Downloader*>(root);
+    if (extractor->m_cacheFile.is_open())
+    {
+        extractor->m_cacheFile.read(reinterpret_cast<char*>(buffer), bufferLength);
+        int bytesRead = static_cast<int>(extractor->m_cacheFile.gcount());
+        extractor->m_cacheFile.clear();
+        return bytesRead == 0 ? AVERROR_EOF : bytesRead;
+    }
+
     std::unique_lock lock(extractor->m_mutex);
 
+    /*
+    *   The window can't grow further than look-ahead past read position,
+    *   and paused transfer needs room for a whole Curl chunk before it can continue.
+    *   Waiting for more than half of look-ahead could never end.
+    */
+    uint64_t bytesWanted = std::min<uint64_t>(bufferLength, extractor->m_lookAhead / 2);
     while (true)
     {
-        int bytesAvailable = static_cast<int>(extractor->m_buffer.size() + extractor->m_positionOffset - extractor->m_position);
-        if (bytesAvailable < bufferLength)
+        uint64_t position = extractor->m_position;
+        bool inWindow = position >= extractor->m_windowOffset && position < extractor->windowEnd();
+
+        // Bytes outside the window may have been downloaded before
+        if (!inWindow && extractor->m_partFileCommitting)
         {
-            if (extractor->m_threadStatus != ThreadStatus::Running)
+            extractor->m_cv.wait(lock);
+            continue;
+        }
+        if (!inWindow && extractor->m_partFile)
+        {
+            size_t bytesRead = extractor->m_partFile->read(position, buffer, bufferLength);
+            if (bytesRead)
             {
-                if (bytesAvailable == 0)
-                    return AVERROR_EOF;
+                extractor->m_position += bytesRead;
+                extractor->resumeTransfer();
+                extractor->scheduleChunks();
+                return static_cast<int>(bytesRead);
             }
-            else
+        }
+
+        // Only positions in the window or right after it are being downloaded
+        bool reachable = position >= extractor->m_windowOffset && position <= extractor->windowEnd();
+        uint64_t bytesAvailable = reachable ? extractor->windowEnd() - position : 0;
+        if (bytesAvailable < bytesWanted)
+        {
+            bool fetching = extractor->m_transferStatus == TransferStatus::Running && reachable;
+            if (fetching || extractor->chunkFetching(position))
             {
+                extractor->resumeTransfer();
                 extractor->m_cv.wait(lock);
                 continue;
             }
+
+            if (bytesAvailable == 0)
+            {
+                bool failed = extractor->m_transferStatus == TransferStatus::Error || extractor->m_transferStatus == TransferStatus::Stopped;
+                if (failed || !extractor->m_fileSize || position >= extractor->m_fileSize)
+                    return AVERROR_EOF;
+
+                // Nothing is downloading the position: it is in a hole between downloaded ranges
+                extractor->restartTransfer(lock, position);
+                continue;
+            }
         }
 
         // More bytes may be available than requested
-        if (bytesAvailable > bufferLength)
+        if (bytesAvailable > static_cast<uint64_t>(bufferLength))
             bytesAvailable = bufferLength;
 
-        uint8_t* data = extractor->m_buffer.data() + (extractor->m_position - extractor->m_positionOffset);
-        std::copy(data, data + bytesAvailable, buffer);
-        extractor->m_position += bytesAvailable;
-        return bytesAvailable;
+        size_t bytesRead = extractor->m_window.peek(extractor->m_position - extractor->m_windowOffset, buffer, bytesAvailable);
+        extractor->m_position += bytesRead;
+        extractor->resumeTransfer();
+        extractor->scheduleChunks();
+        return static_cast<int>(bytesRead);
     }
 }
 
@@ -108,38 +342,68 @@ int64_t Downloader::Seek(void* root, int64_t offset, int whence)
     else if (whence != SEEK_SET)
         return AVERROR(EINVAL);
 
-    if (static_cast<size_t>(offset) <= extractor->m_position && extractor->m_positionOffset == 0)
+    if (extractor->m_cacheFile.is_open())
     {
-        extractor->m_position = offset;
-        return extractor->m_position;
+        extractor->m_cacheFile.seekg(offset);
+        return extractor->m_cacheFile ? offset : AVERROR(EIO);
     }
 
-    lock.unlock();
-    extractor->stopThread();
-    lock.lock();
-
-    extractor->m_buffer.clear();
     extractor->m_position = offset;
-    extractor->m_positionOffset = offset;
-    extractor->startThread(offset);
-    extractor->m_cv.wait(lock);
+    bool inWindow = static_cast<uint64_t>(offset) >= extractor->m_windowOffset && static_cast<uint64_t>(offset) <= extractor->windowEnd();
+    bool downloaded = extractor->m_partFileCommitting || (extractor->m_partFile && extractor->m_partFile->ranges().rangeEnd(offset) > static_cast<uint64_t>(offset));
+    if (inWindow || downloaded)
+    {
+        extractor->resumeTransfer();
+        return extractor->m_position;
+    }
+
+    extractor->restartTransfer(lock, offset);
+    extractor->m_cv.wait(lock, [extractor]() { return extractor->transferStarted(); });
     return extractor->m_position;
 }
 
 Downloader::Downloader(const std::string& videoId)
     : m_logger(kb::Utility::CreateLogger(fmt::format("extractor \"{}\"", videoId)))
     , m_videoId(ytcpp::Utility::ExtractVideoId(videoId))
+    , m_bitrate(0)
     , m_fileSize(0)
-    , m_threadStatus(ThreadStatus::Idle)
+    , m_curl(nullptr, TransferEngine::Release)
+    , m_firstChunk(false)
+    , m_transferStatus(TransferStatus::Idle)
+    , m_transferPaused(false)
+    , m_transferWasPaused(false)
+    , m_transferStart(0)
+    , m_transferEnd(0)
+    , m_chunkSize(InitialChunkSize)
+    , m_parallelism(1)
+    , m_requestAttempt(1)
+    , m_downloadAttempt(1)
+    , m_lookBehind(Config::DownloaderLookBehind())
+    , m_lookAhead(std::max(Config::DownloaderLookAhead(), MinLookAhead))
+    , m_window(m_lookBehind + m_lookAhead)
+    , m_windowOffset(0)
     , m_position(0)
-    , m_positionOffset(0)
+    , m_partFileCommitting(false)
     , m_io(nullptr)
     , m_format(nullptr)
     , m_stream(nullptr)
     , m_codec(nullptr)
     , m_resampler(nullptr)
+    , m_resamplerLayout{}
+    , m_resamplerFormat(AV_SAMPLE_FMT_NONE)
+    , m_resamplerSampleRate(0)
     , m_unitsPerSecond(0)
     , m_seekPosition(0)
+    , m_packet(nullptr)
+    , m_decodedFrame(nullptr)
+    , m_samples(nullptr)
+    , m_samplesCapacity(0)
+    , m_samplesCount(0)
+    , m_samplesRead(0)
+    , m_samplesTimestamp(0)
+    , m_resamplerFlushed(false)
+    , m_repacketizer(nullptr)
+    , m_pendingOpusSamples(0)
 {
     av_log_set_callback([](void* opaque, int level, const char* format, va_list arguments)
     {
@@ -185,33 +449,73 @@ Downloader::Downloader(const std::string& videoId)
         }
     });
 
-    ytcpp::Format::List formats(m_videoId);
-    uint64_t bestBitrate = 0;
-    for (const ytcpp::Format::Instance& format : formats) {
-        if (format->type() != ytcpp::Format::Type::Audio)
-            continue;
+    // Stages are timed to see where time to first audio goes
+    Stopwatch stageStopwatch;
+    float audioUrlMilliseconds = 0.0f;
+    float firstChunkMilliseconds = 0.0f;
 
-        if (format->bitrate() < bestBitrate)
-            continue;
-        bestBitrate = format->bitrate();
-        m_audioUrl = format->url();
+    std::string cachePath = Cache::Lookup(m_videoId);
+    if (!cachePath.empty())
+    {
+        m_cacheFile.open(cachePath, std::ios::binary);
+        m_fileSize = m_cacheFile ? std::filesystem::file_size(cachePath) : 0;
+        if (m_fileSize)
+            m_logger.info("Playing from cache");
+        else
+            m_cacheFile.close();
     }
 
+    if (!m_cacheFile.is_open())
     {
-        std::unique_lock lock(m_mutex);
-        startThread();
-        m_cv.wait(lock);
-    }
+        std::shared_ptr<const FormatCache::AudioFormat> audioFormat = FormatCache::Get(m_videoId);
+        m_audioUrl = audioFormat->url;
+        m_container = audioFormat->container;
+        m_bitrate = audioFormat->bitrate;
+        audioUrlMilliseconds = stageStopwatch.milliseconds();
+        stageStopwatch.reset();
+
+        m_curl.reset(TransferEngine::Acquire());
+        if (!m_curl)
+        {
+            throw std::runtime_error(fmt::format(
+                "kb::Downloader::Downloader(): "
+                "Couldn't initialize Curl [video: \"{}\"]",
+                m_videoId
+            ));
+        }
+        configureTransfer(m_curl.get(), this, &Downloader::DownloaderWriter);
 
-    if (m_threadStatus == ThreadStatus::Error) {
-        stopThread();
-        throw std::runtime_error("Download error");
+        // Downloaded bytes are spooled even if caching is disabled, so seeking back doesn't download them again
+        m_partFile = std::make_unique<Cache::PartFile>(m_videoId);
+        if (!m_partFile->good())
+        {
+            m_logger.warn("Couldn't create part file, seeking back will download audio again");
+            m_partFile.reset();
+        }
+
+        bool transferFailed;
+        {
+            // Failing to start notifies before the wait begins, so the status is checked, not the notification
+            std::unique_lock lock(m_mutex);
+            startTransfer();
+            m_cv.wait(lock, [this]() { return transferStarted(); });
+            transferFailed = m_transferStatus == TransferStatus::Error;
+        }
+
+        if (transferFailed) {
+            stopTransfer();
+            // The cached URL may have stopped working, the next attempt resolves it again
+            FormatCache::Invalidate(m_videoId);
+            throw std::runtime_error("Download error");
+        }
+        firstChunkMilliseconds = stageStopwatch.milliseconds();
+        stageStopwatch.reset();
     }
 
     m_io = avio_alloc_context(nullptr, 0, 0, this, &Downloader::Read, nullptr, &Downloader::Seek);
     if (!m_io)
     {
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't allocate IO context [video: \"{}\"]",
@@ -223,7 +527,7 @@ Downloader::Downloader(const std::string& videoId)
     if (!m_format)
     {
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't allocate format context [video: \"{}\"]",
@@ -231,13 +535,24 @@ Downloader::Downloader(const std::string& videoId)
         ));
     }
     m_format->pb = m_io;
+    m_format->probesize = MaxProbeSize;
+    m_format->max_analyze_duration = MaxAnalyzeDuration;
 
-    int result = avformat_open_input(&m_format, "", nullptr, nullptr);
+    // Known container doesn't have to be detected
+    const AVInputFormat* inputFormat = nullptr;
+    if (!m_container.empty())
+    {
+        inputFormat = av_find_input_format(m_container.c_str());
+        if (!inputFormat)
+            m_logger.warn("Unknown container \"{}\", detecting it", m_container);
+    }
+
+    int result = avformat_open_input(&m_format, "", inputFormat, nullptr);
     if (result < 0)
     {
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't open input [video: \"{}\", return code: {}]",
@@ -245,25 +560,33 @@ Downloader::Downloader(const std::string& videoId)
         ));
     }
 
-    result = avformat_find_stream_info(m_format, nullptr);
-    if (result < 0)
+    // Probing stream info decodes packets, which waits for the download
+    if (!HeaderDescribesAudio(m_format))
     {
-        avformat_close_input(&m_format);
-        avio_context_free(&m_io);
-        stopThread();
-        throw std::runtime_error(fmt::format(
-            "kb::Downloader::Downloader(): "
-            "Couldn't find audio stream info [video: \"{}\", return code: {}]",
-            m_videoId, result
-        ));
+        result = avformat_find_stream_info(m_format, nullptr);
+        if (result < 0)
+        {
+            avformat_close_input(&m_format);
+            avio_context_free(&m_io);
+            stopTransfer();
+            throw std::runtime_error(fmt::format(
+                "kb::Downloader::Downloader(): "
+                "Couldn't find audio stream info [video: \"{}\", return code: {}]",
+                m_videoId, result
+            ));
+        }
     }
+    m_logger.info(
+        "Opened: audio URL {:.0f} ms, first chunk {:.0f} ms, probing {:.0f} ms",
+        audioUrlMilliseconds, firstChunkMilliseconds, stageStopwatch.milliseconds()
+    );
 
     int streamIndex = av_find_best_stream(m_format, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
     if (streamIndex < 0)
     {
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't find best audio stream [video: \"{}\", return code: {}]",
@@ -275,12 +598,57 @@ Downloader::Downloader(const std::string& videoId)
     AVCodecParameters* parameters = m_stream->codecpar;
 
     m_unitsPerSecond = static_cast<int>(static_cast<double>(m_stream->time_base.den) / m_stream->time_base.num);
+
+    // Packet and frame are reused for the whole stream
+    m_packet = av_packet_alloc();
+    m_decodedFrame = av_frame_alloc();
+    if (!m_packet || !m_decodedFrame)
+    {
+        av_frame_free(&m_decodedFrame);
+        av_packet_free(&m_packet);
+        avformat_close_input(&m_format);
+        avio_context_free(&m_io);
+        stopTransfer();
+        throw std::runtime_error(fmt::format(
+            "kb::Downloader::Downloader(): "
+            "Couldn't allocate packet [video: \"{}\"]",
+            m_videoId
+        ));
+    }
+
+    /*
+    *   Discord voice expects 48kHz Opus anyway.
+    *   When the stream already is one, its packets can be sent as they are.
+    */
+    if (parameters->codec_id == AV_CODEC_ID_OPUS && parameters->sample_rate == OutputSampleRate && parameters->ch_layout.nb_channels <= OutputChannelLayout.nb_channels)
+    {
+        m_repacketizer = opus_repacketizer_create();
+        if (!m_repacketizer)
+        {
+            av_frame_free(&m_decodedFrame);
+            av_packet_free(&m_packet);
+            avformat_close_input(&m_format);
+            avio_context_free(&m_io);
+            stopTransfer();
+            throw std::runtime_error(fmt::format(
+                "kb::Downloader::Downloader(): "
+                "Couldn't allocate Opus repacketizer [video: \"{}\"]",
+                m_videoId
+            ));
+        }
+
+        m_logger.info("Passing Opus packets through");
+        return;
+    }
+
     const AVCodec* decoder = avcodec_find_decoder(m_stream->codecpar->codec_id);
     if (!decoder)
     {
+        av_frame_free(&m_decodedFrame);
+        av_packet_free(&m_packet);
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't find audio decoder [video: \"{}\"]",
@@ -291,9 +659,11 @@ Downloader::Downloader(const std::string& videoId)
     m_codec = avcodec_alloc_context3(decoder);
     if (!m_codec)
     {
+        av_frame_free(&m_decodedFrame);
+        av_packet_free(&m_packet);
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't allocate codec context [video: \"{}\"]",
@@ -305,9 +675,11 @@ Downloader::Downloader(const std::string& videoId)
     if (result < 0)
     {
         avcodec_free_context(&m_codec);
+        av_frame_free(&m_decodedFrame);
+        av_packet_free(&m_packet);
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't fill codec context with stream parameters [video: \"{}\", return code: {}]",
@@ -320,9 +692,11 @@ Downloader::Downloader(const std::string& videoId)
     if (result < 0)
     {
         avcodec_free_context(&m_codec);
+        av_frame_free(&m_decodedFrame);
+        av_packet_free(&m_packet);
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't open audio decoder context [video: \"{}\", return code: {}]",
@@ -330,6 +704,13 @@ Downloader::Downloader(const std::string& videoId)
         ));
     }
 
+    // Decoded audio that already is 48kHz stereo only needs its sample format converted
+    if (m_codec->sample_fmt == AV_SAMPLE_FMT_FLTP && m_codec->sample_rate == OutputSampleRate && m_codec->ch_layout.nb_channels == OutputChannelLayout.nb_channels)
+    {
+        m_logger.info("Skipping resampler");
+        return;
+    }
+
     /*
     *   DPP expects PCM data that:
     *       - Is interleaved stereo;
@@ -342,17 +723,19 @@ Downloader::Downloader(const std::string& videoId)
         &outputLayout,
         OutputFormat,
         OutputSampleRate,
-        &parameters->ch_layout,
-        static_cast<AVSampleFormat>(parameters->format),
-        parameters->sample_rate,
+        &m_codec->ch_layout,
+        m_codec->sample_fmt,
+        m_codec->sample_rate,
         0, nullptr
     );
     if (result < 0)
     {
         avcodec_free_context(&m_codec);
+        av_frame_free(&m_decodedFrame);
+        av_packet_free(&m_packet);
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't allocate resampler context [video: \"{}\", return code: {}]",
@@ -365,104 +748,239 @@ Downloader::Downloader(const std::string& videoId)
     {
         swr_free(&m_resampler);
         avcodec_free_context(&m_codec);
+        av_frame_free(&m_decodedFrame);
+        av_packet_free(&m_packet);
         avformat_close_input(&m_format);
         avio_context_free(&m_io);
-        stopThread();
+        stopTransfer();
         throw std::runtime_error(fmt::format(
             "kb::Downloader::Downloader(): "
             "Couldn't initialize resampler [video: \"{}\", return code: {}]",
             m_videoId, result
         ));
     }
+
+    // Decoded frames are checked against this: the header may describe the audio differently
+    av_channel_layout_copy(&m_resamplerLayout, &m_codec->ch_layout);
+    m_resamplerFormat = m_codec->sample_fmt;
+    m_resamplerSampleRate = m_codec->sample_rate;
 }
 
 Downloader::~Downloader()
 {
+    if (m_repacketizer)
+        opus_repacketizer_destroy(m_repacketizer);
+    if (m_samples)
+        av_freep(&m_samples[0]);
+    av_freep(&m_samples);
+    av_frame_free(&m_decodedFrame);
+    av_packet_free(&m_packet);
     swr_free(&m_resampler);
+    av_channel_layout_uninit(&m_resamplerLayout);
     avcodec_free_context(&m_codec);
     avformat_close_input(&m_format);
     avio_context_free(&m_io);
-    stopThread();
+    stopTransfer();
 }
 
-void Downloader::threadFunction(uint64_t startPosition)
+template<typename Target>
+void Downloader::configureTransfer(CURL* curl, Target* target, size_t (*writeFunction)(uint8_t*, size_t, size_t, Target*))
 {
+    auto setOption = [this, curl](CURLoption option, auto value, const char* description)
     {
-        std::lock_guard lock(m_mutex);
-        m_threadStatus = ThreadStatus::Running;
+        CURLcode result = curl_easy_setopt(curl, option, value);
+        if (result != CURLE_OK)
+        {
+            throw std::runtime_error(fmt::format(
+                "kb::Downloader::configureTransfer(): "
+                "Couldn't configure request {} [video: \"{}\", return code: {}]",
+                description, m_videoId, static_cast<int>(result)
+            ));
+        }
+    };
+
+    setOption(CURLOPT_URL, m_audioUrl.c_str(), "URL");
+    if (Config::ProxyEnabled())
+        setOption(CURLOPT_PROXY, Config::ProxyUrl().c_str(), "proxy");
+    setOption(CURLOPT_LOW_SPEED_LIMIT, 15360L, "low speed limit");
+    setOption(CURLOPT_LOW_SPEED_TIME, 5L, "low speed timeout");
+    setOption(CURLOPT_FOLLOWLOCATION, 1L, "redirection");
+    setOption(CURLOPT_HEADERDATA, this, "header target");
+    setOption(CURLOPT_HEADERFUNCTION, &Downloader::HeaderWriter, "header function");
+    setOption(CURLOPT_WRITEDATA, target, "write target");
+    setOption(CURLOPT_WRITEFUNCTION, writeFunction, "write function");
+}
+
+void Downloader::trimWindow()
+{
+    uint64_t keepPosition = m_position > m_lookBehind ? m_position - m_lookBehind : 0;
+    if (keepPosition <= m_windowOffset)
+        return;
+    m_windowOffset += m_window.discard(keepPosition - m_windowOffset);
+}
+
+void Downloader::resumeTransfer()
+{
+    if (!m_transferPaused)
+        return;
+
+    trimWindow();
+    if (m_window.free() < CURL_MAX_WRITE_SIZE)
+        return;
+
+    m_transferPaused = false;
+    TransferEngine::Resume(m_curl.get());
+}
+
+uint64_t Downloader::nextMissing(uint64_t position) const
+{
+    while (true)
+    {
+        uint64_t next = m_partFile ? m_partFile->ranges().rangeEnd(position) : position;
+        if (m_transferStatus == TransferStatus::Running && next >= windowEnd() && next < m_transferEnd)
+            next = m_transferEnd;
+        for (const auto& chunk : m_chunkTransfers)
+        {
+            if (chunk->running && next >= chunk->position && next < chunk->end)
+                next = chunk->end;
+        }
+
+        if (next == position)
+            return position;
+        position = next;
     }
+}
 
-    try
+bool Downloader::chunkFetching(uint64_t position) const
+{
+    for (const auto& chunk : m_chunkTransfers)
     {
-        std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> curl(curl_easy_init(), curl_easy_cleanup);
-        if (!curl.get())
-            throw std::runtime_error("Couldn't initialize Curl");
+        if (chunk->running && position >= chunk->position && position < chunk->end)
+            return true;
+    }
+    return false;
+}
 
-        CURLcode result = curl_easy_setopt(curl.get(), CURLOPT_URL, m_audioUrl.c_str());
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request URL [return code: {}]", static_cast<int>(result)));
+void Downloader::adaptChunks(uint64_t bytes, float seconds)
+{
+    // Short chunks are dominated by request latency and say nothing about throttling
+    if (bytes < MinChunkSize || seconds <= 0.0f || !m_bitrate)
+        return;
+
+    double speed = bytes / seconds;
+    double playbackSpeed = m_bitrate / 8.0;
+    if (speed < playbackSpeed * MinSpeedRatio)
+    {
+        m_chunkSize = std::max(m_chunkSize / 2, MinChunkSize);
+        if (m_partFile)
+            m_parallelism = std::min(m_parallelism + 1, MaxParallelChunks);
+        m_logger.warn(
+            "Download is throttled ({} KiB/s), using chunks of {} KiB with {} parallel downloads",
+            static_cast<uint64_t>(speed / 1024),
+            m_chunkSize / 1024,
+            m_parallelism
+        );
+    }
+    else if (m_chunkSize < MaxChunkSize)
+    {
+        m_chunkSize = std::min(m_chunkSize * 2, MaxChunkSize);
+    }
+}
 
-        if (Config::ProxyEnabled())
+void Downloader::scheduleChunks()
+{
+    if (!m_partFile || !m_fileSize || m_transferStatus != TransferStatus::Running)
+        return;
+
+    uint64_t horizon = std::min(m_position + ParallelAhead, m_fileSize);
+    for (int chunkIndex = 0; chunkIndex < m_parallelism - 1; ++chunkIndex)
+    {
+        if (chunkIndex == static_cast<int>(m_chunkTransfers.size()))
         {
-            result = curl_easy_setopt(curl.get(), CURLOPT_PROXY, Config::ProxyUrl().c_str());
-            if (result != CURLE_OK)
-                throw std::runtime_error(fmt::format("Couldn't configure request proxy [return code: {}]", static_cast<int>(result)));
-        }
+            auto chunk = std::make_unique<ChunkTransfer>(this);
+            chunk->curl.reset(TransferEngine::Acquire());
+            if (!chunk->curl)
+                return;
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_LOW_SPEED_LIMIT, 15360);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request low speed limit [return code: {}]", static_cast<int>(result)));
+            try
+            {
+                configureTransfer(chunk->curl.get(), chunk.get(), &Downloader::ChunkWriter);
+            }
+            catch (const std::runtime_error& error)
+            {
+                m_logger.warn("Couldn't start parallel download: {}", error.what());
+                return;
+            }
+            m_chunkTransfers.push_back(std::move(chunk));
+        }
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_LOW_SPEED_TIME, 5);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request low speed timeout [return code: {}]", static_cast<int>(result)));
+        ChunkTransfer& chunk = *m_chunkTransfers[chunkIndex];
+        if (chunk.running)
+            continue;
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1L);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request redirection [return code: {}]", static_cast<int>(result)));
+        uint64_t startPosition = nextMissing(m_transferEnd);
+        if (startPosition >= horizon)
+            return;
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_XFERINFODATA, this);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request progress callback target [return code: {}]", static_cast<int>(result)));
+        // Chunk stops where something downloaded or being downloaded starts
+        uint64_t endPosition = std::min({ startPosition + m_chunkSize, m_partFile->ranges().nextStart(startPosition), m_fileSize });
+        for (const auto& other : m_chunkTransfers)
+        {
+            if (other->running && other->position > startPosition)
+                endPosition = std::min(endPosition, other->position);
+        }
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_XFERINFOFUNCTION, &Downloader::ProgressCallback);
+        CURLcode result = curl_easy_setopt(chunk.curl.get(), CURLOPT_RANGE, fmt::format("{}-{}", startPosition, endPosition - 1).c_str());
         if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request progress callback function [return code: {}]", static_cast<int>(result)));
+            return;
+
+        chunk.start = startPosition;
+        chunk.position = startPosition;
+        chunk.end = endPosition;
+        chunk.running = true;
+        chunk.stopwatch.reset();
+        TransferEngine::Add(chunk.curl.get(), [this, &chunk](CURLcode result) { chunkDone(chunk, result); });
+    }
+}
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_NOPROGRESS, 0L);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't enable request progress callback [return code: {}]", static_cast<int>(result)));
+void Downloader::chunkDone(ChunkTransfer& chunk, CURLcode result)
+{
+    std::lock_guard lock(m_mutex);
+    chunk.running = false;
+    m_cv.notify_all();
+    if (m_transferStatus == TransferStatus::Stopped)
+        return; // Transfer is cancelled
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, this);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request header target [return code: {}]", static_cast<int>(result)));
+    if (result != CURLE_OK || chunk.position != chunk.end)
+    {
+        // Missing part of the chunk is downloaded again later
+        m_logger.warn("Parallel download of range {}-{} failed at position {} (return code: {})", chunk.start, chunk.end, chunk.position, static_cast<int>(result));
+    }
+    else
+    {
+        adaptChunks(chunk.end - chunk.start, chunk.stopwatch.seconds());
+    }
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, &Downloader::HeaderWriter);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request header function [return code: {}]", static_cast<int>(result)));
+    if (m_transferStatus == TransferStatus::Idle)
+        continueTransfer();
+    else
+        scheduleChunks();
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, this);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request write target [return code: {}]", static_cast<int>(result)));
+    commitPartFile();
+}
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &Downloader::DownloaderWriter);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request write function [return code: {}]", static_cast<int>(result)));
+void Downloader::transferDone(CURLcode result)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_transferStatus == TransferStatus::Stopped)
+        return; // Transfer is cancelled
 
-        result = curl_easy_setopt(curl.get(), CURLOPT_RANGE, fmt::format("{}-", startPosition).c_str());
+    m_transferStatus = TransferStatus::Idle;
+    try
+    {
         if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't configure request range [return code: {}]", static_cast<int>(result)));
-
-        m_logger.info("Starting download from position {}", startPosition);
-        for (int requestAttempt = 1, downloadAttempt = 1; true;)
         {
-            result = curl_easy_perform(curl.get());
-            if (result == CURLE_OK)
-                break;
-            else if (result == CURLE_ABORTED_BY_CALLBACK)
-                return; // Thread is cancelled
-
-            if (requestAttempt == MaxRequestAttempts)
+            if (m_requestAttempt == MaxRequestAttempts)
             {
                 m_logger.error("All {} request attempts failed (return code: {})", MaxRequestAttempts, static_cast<int>(result));
                 throw std::runtime_error(fmt::format(
@@ -472,232 +990,604 @@ void Downloader::threadFunction(uint64_t startPosition)
                 );
             }
 
-            startPosition = m_positionOffset + m_buffer.size();
             if (result == CURLE_OPERATION_TIMEDOUT || result == CURLE_RECV_ERROR)
             {
                 m_logger.warn(
                     "Download attempt #{} failed, retrying at position {}",
-                    downloadAttempt++,
-                    startPosition
+                    m_downloadAttempt++,
+                    windowEnd()
                 );
             }
             else
             {
                 m_logger.warn(
                     "Request attempt #{}/{} failed (return code: {}), retrying at position {}",
-                    requestAttempt++,
+                    m_requestAttempt++,
                     MaxRequestAttempts,
                     static_cast<int>(result),
-                    startPosition
+                    windowEnd()
                 );
             }
 
-            result = curl_easy_setopt(curl.get(), CURLOPT_RANGE, fmt::format("{}-", startPosition).c_str());
+            // Failed chunk is retried where it stopped
+            m_transferEnd = windowEnd();
+            if (continueTransfer())
+                return;
+        }
+        else
+        {
+            long responseCode = 0;
+            result = curl_easy_getinfo(m_curl.get(), CURLINFO_RESPONSE_CODE, &responseCode);
             if (result != CURLE_OK)
-                throw std::runtime_error(fmt::format("Couldn't configure request range [return code: {}]", static_cast<int>(result)));
+                throw std::runtime_error(fmt::format("Couldn't retrieve response code [return code: {}]", static_cast<int>(result)));
+
+            /*
+             * 200 = OK: whole file successfully downloaded
+             * 206 = Partial Content: whole range successfully downloaded
+            */
+            if (responseCode != 200 && responseCode != 206)
+                throw std::runtime_error(fmt::format("Couldn't initiate download [HTTP response code: {}]", responseCode));
+
+            m_requestAttempt = 1;
+            m_downloadAttempt = 1;
+            if (!m_transferWasPaused)
+                adaptChunks(windowEnd() - m_transferStart, m_transferStopwatch.seconds());
+
+            if (continueTransfer())
+                return;
         }
 
-        long responseCode = 0;
-        result = curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &responseCode);
-        if (result != CURLE_OK)
-            throw std::runtime_error(fmt::format("Couldn't retrieve response code [return code: {}]", static_cast<int>(result)));
+        commitPartFile();
 
-        /*
-         * 200 = OK: whole file successfully downloaded
-         * 206 = Partial Content: whole range successfully downloaded
-        */
-        if (responseCode != 200 && responseCode != 206)
-            throw std::runtime_error(fmt::format("Couldn't initiate download [HTTP response code: {}]", responseCode));
-
-        std::lock_guard lock(m_mutex);
-        m_threadStatus = ThreadStatus::Idle;
         m_cv.notify_all();
-        if (m_buffer.size() == m_fileSize)
+        if (windowEnd() == m_fileSize)
             m_logger.info("Download finished successfully (total: {})", m_fileSize);
         else
-            m_logger.info("Download finished successfully (current/total: {}/{})", m_buffer.size(), m_fileSize);
+            m_logger.info("Download finished successfully (current/total: {}/{})", windowEnd(), m_fileSize);
     }
     catch (const std::runtime_error& error)
     {
-        std::lock_guard lock(m_mutex);
-        m_threadStatus = ThreadStatus::Error;
+        m_transferStatus = TransferStatus::Error;
         m_cv.notify_all();
         m_logger.error("Download error: {}", error.what());
     }
 }
 
-void Downloader::startThread(uint64_t startPosition)
+void Downloader::commitPartFile()
+{
+    if (!m_partFile || !m_fileSize || !m_partFile->committable(m_fileSize))
+        return;
+
+    /*
+    *   Adding to cache renames the file, evicts others and saves the index:
+    *   slow disk must not stall the transfer engine thread shared by every download.
+    *   Reads outside the window wait until the part file comes back.
+    */
+    auto commit = std::make_shared<PartFileCommit>(this, std::move(m_partFile), m_fileSize);
+    m_partFileCommitting = true;
+    if (!BlockingPool::Post(CommitPoolKey, [commit]() { commit->run(); }))
+    {
+        // Pool is stopped: the file stays readable, it just isn't cached
+        m_partFile = std::move(commit->partFile);
+        m_partFileCommitting = false;
+    }
+}
+
+bool Downloader::continueTransfer()
 {
-    if (m_thread.joinable())
-        m_thread.join();
-    m_thread = std::thread(&Downloader::threadFunction, this, startPosition);
+    uint64_t startPosition = nextMissing(windowEnd());
+
+    // Without known file size, the end is reached when a chunk comes short
+    bool finished = m_fileSize ? startPosition >= m_fileSize : windowEnd() < m_transferEnd;
+    if (finished)
+        return false;
+
+    if (startPosition != windowEnd())
+    {
+        // Bytes downloaded before are read from the part file
+        m_window.clear();
+        m_windowOffset = startPosition;
+    }
+    startTransfer(startPosition);
+    return true;
 }
 
-void Downloader::stopThread()
+void Downloader::restartTransfer(std::unique_lock<std::mutex>& lock, uint64_t startPosition)
 {
-    m_threadStatus = ThreadStatus::Stopped;
-    if (m_thread.joinable())
-        m_thread.join();
+    lock.unlock();
+    stopTransfer();
+    lock.lock();
+
+    m_window.clear();
+    m_windowOffset = startPosition;
+    m_requestAttempt = 1;
+    m_downloadAttempt = 1;
+    startTransfer(startPosition);
+}
+
+void Downloader::startTransfer(uint64_t startPosition)
+{
+    m_transferStatus = TransferStatus::Running;
+    m_transferPaused = false;
+    m_transferWasPaused = false;
+    m_firstChunk = true;
+
+    // Download stops at the chunk end or where previously downloaded bytes start
+    m_transferStart = startPosition;
+    m_transferEnd = startPosition + m_chunkSize;
+    if (m_partFile)
+        m_transferEnd = std::min(m_transferEnd, m_partFile->ranges().nextStart(startPosition));
+    for (const auto& chunk : m_chunkTransfers)
+    {
+        if (chunk->running && chunk->position > startPosition)
+            m_transferEnd = std::min(m_transferEnd, chunk->position);
+    }
+    if (m_fileSize)
+        m_transferEnd = std::min(m_transferEnd, m_fileSize);
+
+    std::string range = fmt::format("{}-{}", startPosition, m_transferEnd - 1);
+    CURLcode result = curl_easy_setopt(m_curl.get(), CURLOPT_RANGE, range.c_str());
+    if (result != CURLE_OK)
+    {
+        m_transferStatus = TransferStatus::Error;
+        m_cv.notify_all();
+        m_logger.error("Download error: Couldn't configure request range [return code: {}]", static_cast<int>(result));
+        return;
+    }
+
+    m_logger.info("Downloading range {}", range);
+    m_transferStopwatch.reset();
+    TransferEngine::Add(m_curl.get(), [this](CURLcode result) { transferDone(result); });
+    scheduleChunks();
+}
+
+void Downloader::stopTransfer()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_transferStatus = TransferStatus::Stopped;
+        m_cv.notify_all();
+    }
+
+    // Transfer callbacks lock the mutex, so it must not be held while waiting for them
+    if (m_curl)
+        TransferEngine::Remove(m_curl.get());
+    for (const auto& chunk : m_chunkTransfers)
+        TransferEngine::Remove(chunk->curl.get());
+
+    std::unique_lock lock(m_mutex);
+    for (const auto& chunk : m_chunkTransfers)
+        chunk->running = false;
+
+    // Stopped transfer starts no more commits, the running one gives the part file back
+    m_cv.wait(lock, [this]() { return !m_partFileCommitting; });
+}
+
+int Downloader::flushOpusFrames()
+{
+    if (m_pendingOpusFrames.empty())
+        return OPUS_OK;
+
+    Frame packet;
+    packet.setTimestamp(m_pendingOpusFrames.front().timestamp());
+    opus_repacketizer_init(m_repacketizer);
+    for (const Frame& frame : m_pendingOpusFrames)
+    {
+        int result = opus_repacketizer_cat(m_repacketizer, frame.data(), static_cast<opus_int32>(frame.size()));
+        if (result == OPUS_OK)
+        {
+            packet.setDuration(packet.duration() + frame.duration());
+            continue;
+        }
+
+        // Frames with different configurations can't share a packet
+        packet.resize(MaxOpusPacketSize);
+        opus_int32 packetSize = opus_repacketizer_out(m_repacketizer, packet.data(), MaxOpusPacketSize);
+        if (packetSize < 0)
+            return packetSize;
+        packet.resize(packetSize);
+        m_opusPackets.push_back(std::move(packet));
+
+        packet = Frame();
+        packet.setTimestamp(frame.timestamp());
+        packet.setDuration(frame.duration());
+        opus_repacketizer_init(m_repacketizer);
+        result = opus_repacketizer_cat(m_repacketizer, frame.data(), static_cast<opus_int32>(frame.size()));
+        if (result != OPUS_OK)
+            return result;
+    }
+
+    packet.resize(MaxOpusPacketSize);
+    opus_int32 packetSize = opus_repacketizer_out(m_repacketizer, packet.data(), MaxOpusPacketSize);
+    if (packetSize < 0)
+        return packetSize;
+    packet.resize(packetSize);
+    m_opusPackets.push_back(std::move(packet));
+
+    m_pendingOpusFrames.clear();
+    m_pendingOpusSamples = 0;
+    return OPUS_OK;
+}
+
+int Downloader::repacketize(const AVPacket& packet, int64_t timestamp)
+{
+    int frameCount = opus_packet_get_nb_frames(packet.data, packet.size);
+    if (frameCount < 0)
+        return frameCount;
+    int frameSamples = opus_packet_get_samples_per_frame(packet.data, OutputSampleRate);
+
+    // Most packets are exactly one Discord frame long and don't need any processing
+    if (frameCount * frameSamples == OpusFrameSamples && m_pendingOpusFrames.empty())
+    {
+        Frame frame;
+        if (!frame.assign(packet.data, packet.size))
+        {
+            m_logger.warn("Dropping Opus packet of {} bytes, it doesn't fit a frame", packet.size);
+            return OPUS_OK;
+        }
+        frame.setTimestamp(timestamp);
+        frame.setDuration(OpusFrameDuration);
+        m_opusPackets.push_back(std::move(frame));
+        return OPUS_OK;
+    }
+
+    // Split the packet into single frames first: the repacketizer is reused for merging them
+    m_splitOpusFrames.clear();
+    opus_repacketizer_init(m_repacketizer);
+    int result = opus_repacketizer_cat(m_repacketizer, packet.data, packet.size);
+    if (result != OPUS_OK)
+        return result;
+
+    for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex)
+    {
+        Frame& frame = m_splitOpusFrames.emplace_back();
+        frame.resize(MaxOpusPacketSize);
+        opus_int32 frameSize = opus_repacketizer_out_range(m_repacketizer, frameIndex, frameIndex + 1, frame.data(), MaxOpusPacketSize);
+        if (frameSize < 0)
+            return frameSize;
+        frame.resize(frameSize);
+        frame.setTimestamp(timestamp + frameIndex * frameSamples * 1'000 / OutputSampleRate);
+        frame.setDuration(frameSamples * 1'000 / OutputSampleRate);
+    }
+
+    // Long frames are sent one by one, short ones are merged until there is enough of them
+    for (Frame& frame : m_splitOpusFrames)
+    {
+        if (frameSamples >= OpusFrameSamples)
+        {
+            result = flushOpusFrames();
+            if (result != OPUS_OK)
+                return result;
+            m_opusPackets.push_back(std::move(frame));
+            continue;
+        }
+
+        m_pendingOpusFrames.push_back(std::move(frame));
+        m_pendingOpusSamples += frameSamples;
+        if (m_pendingOpusSamples >= OpusFrameSamples)
+        {
+            result = flushOpusFrames();
+            if (result != OPUS_OK)
+                return result;
+        }
+    }
+    m_splitOpusFrames.clear();
+    return OPUS_OK;
+}
+
+Downloader::Frame Downloader::extractOpusFrame()
+{
+    while (m_opusPackets.empty())
+    {
+        if (!readPacket())
+        {
+            int result = flushOpusFrames();
+            if (result != OPUS_OK)
+            {
+                throw std::runtime_error(fmt::format(
+                    "kb::Downloader::extractOpusFrame(): "
+                    "Couldn't repacketize last Opus frames [video: \"{}\", return code: {}]",
+                    m_videoId, result
+                ));
+            }
+
+            if (m_opusPackets.empty())
+                return {};
+            break;
+        }
+
+        int result = repacketize(*m_packet, static_cast<int64_t>(static_cast<double>(m_packet->dts) / m_unitsPerSecond * 1'000));
+        av_packet_unref(m_packet);
+        if (result != OPUS_OK)
+        {
+            throw std::runtime_error(fmt::format(
+                "kb::Downloader::extractOpusFrame(): "
+                "Couldn't repacketize Opus packet [video: \"{}\", return code: {}]",
+                m_videoId, result
+            ));
+        }
+    }
+
+    Frame frame = std::move(m_opusPackets.front());
+    m_opusPackets.pop_front();
+    return frame;
+}
+
+bool Downloader::readable()
+{
+    if (m_cacheFile.is_open())
+        return true;
+
+    // Same conditions Read() waits on
+    std::lock_guard lock(m_mutex);
+    uint64_t position = m_position;
+    uint64_t bytesWanted = std::min<uint64_t>(ReadableSize, m_lookAhead / 2);
+    if (m_fileSize)
+        bytesWanted = std::min(bytesWanted, m_fileSize > position ? m_fileSize - position : 0);
+
+    if (m_partFile && m_partFile->ranges().covers(position, position + bytesWanted))
+        return true;
+
+    bool reachable = position >= m_windowOffset && position <= windowEnd();
+    if (reachable && windowEnd() - position >= bytesWanted)
+        return true;
+
+    // Complete file is readable again once it is committed
+    if (m_partFileCommitting)
+        return false;
+
+    bool fetching = m_transferStatus == TransferStatus::Running && reachable;
+    return !fetching && !chunkFetching(position);
 }
 
 void Downloader::seekTo(int64_t timestamp)
 {
     m_seekPosition = timestamp * m_unitsPerSecond;
     av_seek_frame(m_format, m_stream->index, m_seekPosition, AVSEEK_FLAG_BACKWARD);
+
+    m_pendingOpusFrames.clear();
+    m_pendingOpusSamples = 0;
+    m_opusPackets.clear();
+
+    // Samples decoded before seeking belong to the old position
+    m_samplesCount = 0;
+    m_samplesRead = 0;
+    if (m_codec)
+        avcodec_flush_buffers(m_codec);
+
+    // Delayed samples are dropped by reinitializing the resampler
+    if (m_resampler)
+    {
+        swr_close(m_resampler);
+        swr_init(m_resampler);
+    }
+    m_resamplerFlushed = false;
 }
 
 Downloader::Frame Downloader::extractFrame()
 {
-    Frame rawFrame = m_overflowFrame;
-    m_overflowFrame.clear();
+    if (passthrough())
+        return extractOpusFrame();
 
+    Frame rawFrame;
     while (rawFrame.size() < FrameSize)
     {
-        AVPacket packet;
-        while (true)
+        if (m_samplesRead == m_samplesCount && !decodeSamples())
+            break;
+
+        // Samples that don't fit stay in the buffer for the next frame
+        if (rawFrame.timestamp() == -1)
+            rawFrame.setTimestamp(m_samplesTimestamp + static_cast<int64_t>(m_samplesRead) * 1'000 / OutputSampleRate);
+
+        // Resampler already interleaves the samples, so they are copied as a whole
+        int samplesCopied = std::min(m_samplesCount - m_samplesRead, static_cast<int>((FrameSize - rawFrame.size()) / OutputSampleSize));
+        const uint8_t* samples = m_samples[0] + m_samplesRead * OutputSampleSize;
+        std::copy(samples, samples + samplesCopied * OutputSampleSize, rawFrame.data() + rawFrame.size());
+
+        rawFrame.resize(rawFrame.size() + samplesCopied * OutputSampleSize);
+        m_samplesRead += samplesCopied;
+    }
+    return rawFrame;
+}
+
+bool Downloader::readPacket()
+{
+    while (av_read_frame(m_format, m_packet) >= 0)
+    {
+        if (m_packet->stream_index != m_stream->index || (m_seekPosition != 0 && m_packet->dts < m_seekPosition))
         {
-            if (av_read_frame(m_format, &packet) < 0)
-            {
-                av_packet_unref(&packet);
-                return rawFrame;
-            }
+            av_packet_unref(m_packet);
+            continue;
+        }
 
-            if (m_seekPosition != 0 && packet.dts < m_seekPosition)
-            {
-                av_packet_unref(&packet);
-                continue;
-            }
+        m_seekPosition = 0;
+        return true;
+    }
+    return false;
+}
+
+void Downloader::reserveSamples(int sampleCount)
+{
+    // Samples buffer only grows, so it stops being reallocated after a few frames
+    if (sampleCount <= m_samplesCapacity)
+        return;
+
+    if (m_samples)
+        av_freep(&m_samples[0]);
+    av_freep(&m_samples);
+    m_samplesCapacity = 0;
+
+    int result = av_samples_alloc_array_and_samples(&m_samples, nullptr, OutputChannelLayout.nb_channels, sampleCount, OutputFormat, 0);
+    if (result < 0)
+    {
+        throw std::runtime_error(fmt::format(
+            "kb::Downloader::reserveSamples(): "
+            "Couldn't allocate samples buffer [video: \"{}\", return code: {}]",
+            m_videoId, result
+        ));
+    }
+    m_samplesCapacity = sampleCount;
+}
 
-            m_seekPosition = 0;
+bool Downloader::decodeSamples()
+{
+    while (true)
+    {
+        int result = avcodec_receive_frame(m_codec, m_decodedFrame);
+        if (result == 0)
             break;
-        }
+        else if (result == AVERROR_EOF)
+            return flushResampler();
+        else if (result != AVERROR(EAGAIN))
+            return false;
 
-        if (rawFrame.timestamp() == -1)
-            rawFrame.setTimestamp(static_cast<int64_t>(static_cast<double>(packet.dts) / m_unitsPerSecond * 1'000));
+        // Decoder needs more data: at the end of stream it is drained
+        if (readPacket())
+        {
+            result = avcodec_send_packet(m_codec, m_packet);
+            av_packet_unref(m_packet);
+        }
+        else
+        {
+            result = avcodec_send_packet(m_codec, nullptr);
+        }
 
-        int result = avcodec_send_packet(m_codec, &packet);
-        if (result < 0)
+        if (result < 0 && result != AVERROR_EOF)
         {
-            av_packet_unref(&packet);
             throw std::runtime_error(fmt::format(
-                "kb::Downloader::extractFrame(): "
+                "kb::Downloader::decodeSamples(): "
                 "Couldn't send packet [video: \"{}\", return code: {}]",
                 m_videoId, result
             ));
         }
+    }
+
+    int inputSamples = m_decodedFrame->nb_samples;
+    bool bypassable = m_decodedFrame->format == AV_SAMPLE_FMT_FLTP && m_decodedFrame->sample_rate == OutputSampleRate && m_decodedFrame->ch_layout.nb_channels == OutputChannelLayout.nb_channels;
+    bool resamplerMatches = m_resampler
+        && m_decodedFrame->format == m_resamplerFormat
+        && m_decodedFrame->sample_rate == m_resamplerSampleRate
+        && av_channel_layout_compare(&m_decodedFrame->ch_layout, &m_resamplerLayout) == 0;
 
-        AVFrame* frame = av_frame_alloc();
-        if (!frame)
+    try
+    {
+        // Frame may differ from the header or from previous frames: resampler is rebuilt for it
+        if ((m_resampler || !bypassable) && !resamplerMatches)
         {
-            av_packet_unref(&packet);
-            throw std::runtime_error(fmt::format(
-                "kb::Downloader::extractFrame(): "
-                "Couldn't allocate frame [video: \"{}\"]",
-                m_videoId
-            ));
+            m_logger.info("Decoded audio format changed, configuring resampler");
+            configureResampler(*m_decodedFrame);
         }
+        reserveSamples(m_resampler ? swr_get_out_samples(m_resampler, inputSamples) : inputSamples);
+    }
+    catch (const std::runtime_error&)
+    {
+        av_frame_unref(m_decodedFrame);
+        throw;
+    }
 
-        while (avcodec_receive_frame(m_codec, frame) >= 0)
-        {
-            uint8_t** buffer = nullptr;
-            int bytesAllocated = av_samples_alloc_array_and_samples(&buffer, nullptr, OutputChannelLayout.nb_channels, frame->nb_samples, OutputFormat, 0);
-            if (bytesAllocated < 0)
-            {
-                av_frame_free(&frame);
-                av_packet_unref(&packet);
-                throw std::runtime_error(fmt::format(
-                    "kb::Downloader::extractFrame(): "
-                    "Couldn't allocate samples buffer [video: \"{}\", return code: {}]",
-                    m_videoId, bytesAllocated
-                ));
-            }
+    int64_t timestamp = m_decodedFrame->best_effort_timestamp;
+    if (timestamp != AV_NOPTS_VALUE)
+    {
+        m_samplesTimestamp = static_cast<int64_t>(static_cast<double>(timestamp) / m_unitsPerSecond * 1'000);
 
-            int samplesConverted = swr_convert(m_resampler, buffer, frame->nb_samples, (const uint8_t**)frame->data, frame->nb_samples);
-            if (samplesConverted < 0)
-            {
-                av_freep(&buffer[0]);
-                av_frame_free(&frame);
-                av_packet_unref(&packet);
-                throw std::runtime_error(fmt::format(
-                    "kb::Downloader::extractFrame(): "
-                    "Couldn't convert samples [video: \"{}\", return code: {}]",
-                    m_videoId, samplesConverted
-                ));
-            }
+        // Resampler output lags behind its input
+        if (m_resampler)
+            m_samplesTimestamp -= swr_get_delay(m_resampler, 1'000);
+    }
+    else
+    {
+        m_samplesTimestamp += static_cast<int64_t>(m_samplesCount) * 1'000 / OutputSampleRate;
+    }
 
-            int bytesConverted = av_samples_get_buffer_size(nullptr, OutputChannelLayout.nb_channels, samplesConverted, OutputFormat, 0);
-            if (bytesConverted < 0)
-            {
-                av_freep(&buffer[0]);
-                av_frame_free(&frame);
-                av_packet_unref(&packet);
-                throw std::runtime_error(fmt::format(
-                    "kb::Downloader::extractFrame(): "
-                    "Couldn't get converted bytes count [video: \"{}\", return code: {}]",
-                    m_videoId, bytesConverted
-                ));
-            }
+    int samplesConverted = inputSamples;
+    if (m_resampler)
+    {
+        samplesConverted = swr_convert(m_resampler, m_samples, m_samplesCapacity, (const uint8_t**)m_decodedFrame->data, inputSamples);
+    }
+    else
+    {
+        ConvertSamples(
+            reinterpret_cast<const float*>(m_decodedFrame->data[0]),
+            reinterpret_cast<const float*>(m_decodedFrame->data[1]),
+            reinterpret_cast<int16_t*>(m_samples[0]),
+            inputSamples
+        );
+    }
+    av_frame_unref(m_decodedFrame);
 
-            rawFrame.reserve(rawFrame.size() + bytesConverted);
-            for (int sampleIndex = 0; sampleIndex < samplesConverted; ++sampleIndex)
-            {
-                uint8_t* leftChannelSample = buffer[0] + sampleIndex * 2;
-                rawFrame.insert(rawFrame.end(), leftChannelSample, leftChannelSample + 2);
-                uint8_t* rightChannelSample = buffer[1] + sampleIndex * 2;
-                rawFrame.insert(rawFrame.end(), rightChannelSample, rightChannelSample + 2);
-            }
+    if (samplesConverted < 0)
+    {
+        throw std::runtime_error(fmt::format(
+            "kb::Downloader::decodeSamples(): "
+            "Couldn't convert samples [video: \"{}\", return code: {}]",
+            m_videoId, samplesConverted
+        ));
+    }
 
-            samplesConverted = swr_convert(m_resampler, buffer, frame->nb_samples, nullptr, 0);
-            if (samplesConverted < 0)
-            {
-                av_freep(&buffer[0]);
-                av_frame_free(&frame);
-                av_packet_unref(&packet);
-                throw std::runtime_error(fmt::format(
-                    "kb::Downloader::extractFrame(): "
-                    "Couldn't flush resampler [video: \"{}\", return code: {}]",
-                    m_videoId, samplesConverted
-                ));
-            }
-            else if (samplesConverted != 0)
-            {
-                int bytesConverted = av_samples_get_buffer_size(nullptr, OutputChannelLayout.nb_channels, samplesConverted, OutputFormat, 0);
-                if (bytesConverted < 0)
-                {
-                    av_freep(&buffer[0]);
-                    av_frame_free(&frame);
-                    av_packet_unref(&packet);
-                    throw std::runtime_error(fmt::format(
-                        "kb::Downloader::extractFrame(): "
-                        "Couldn't get converted bytes count [video: \"{}\", return code: {}]",
-                        m_videoId, bytesConverted
-                    ));
-                }
-
-                rawFrame.reserve(rawFrame.size() + bytesConverted);
-                for (int sampleIndex = 0; sampleIndex < samplesConverted; ++sampleIndex)
-                {
-                    uint8_t* leftChannelSample = buffer[0] + sampleIndex * 2;
-                    rawFrame.insert(rawFrame.end(), leftChannelSample, leftChannelSample + 2);
-                    uint8_t* rightChannelSample = buffer[1] + sampleIndex * 2;
-                    rawFrame.insert(rawFrame.end(), rightChannelSample, rightChannelSample + 2);
-                }
-            }
+    m_samplesCount = samplesConverted;
+    m_samplesRead = 0;
+    return true;
+}
 
-            av_freep(&buffer[0]);
-        }
+void Downloader::configureResampler(const AVFrame& frame)
+{
+    swr_free(&m_resampler);
+    av_channel_layout_uninit(&m_resamplerLayout);
+    m_resamplerFlushed = false;
 
-        av_frame_free(&frame);
-        av_packet_unref(&packet);
+    AVChannelLayout outputLayout = OutputChannelLayout;
+    int result = swr_alloc_set_opts2(
+        &m_resampler,
+        &outputLayout,
+        OutputFormat,
+        OutputSampleRate,
+        &frame.ch_layout,
+        static_cast<AVSampleFormat>(frame.format),
+        frame.sample_rate,
+        0, nullptr
+    );
+    if (result >= 0)
+        result = swr_init(m_resampler);
+    if (result < 0)
+    {
+        swr_free(&m_resampler);
+        throw std::runtime_error(fmt::format(
+            "kb::Downloader::configureResampler(): "
+            "Couldn't create resampler for decoded audio [video: \"{}\", return code: {}]",
+            m_videoId, result
+        ));
     }
 
-    if (rawFrame.size() > FrameSize)
+    av_channel_layout_copy(&m_resamplerLayout, &frame.ch_layout);
+    m_resamplerFormat = static_cast<AVSampleFormat>(frame.format);
+    m_resamplerSampleRate = frame.sample_rate;
+}
+
+bool Downloader::flushResampler()
+{
+    if (!m_resampler || m_resamplerFlushed)
+        return false;
+    m_resamplerFlushed = true;
+
+    int maxSamples = swr_get_out_samples(m_resampler, 0);
+    if (maxSamples <= 0)
+        return false;
+    reserveSamples(maxSamples);
+
+    int samplesFlushed = swr_convert(m_resampler, m_samples, maxSamples, nullptr, 0);
+    if (samplesFlushed < 0)
     {
-        m_overflowFrame.setTimestamp(rawFrame.timestamp() + 60);
-        m_overflowFrame.insert(m_overflowFrame.end(), rawFrame.begin() + FrameSize, rawFrame.end());
-        rawFrame.erase(rawFrame.begin() + FrameSize, rawFrame.end());
+        throw std::runtime_error(fmt::format(
+            "kb::Downloader::flushResampler(): "
+            "Couldn't flush resampler [video: \"{}\", return code: {}]",
+            m_videoId, samplesFlushed
+        ));
     }
-    return rawFrame;
+
+    m_samplesTimestamp += static_cast<int64_t>(m_samplesCount) * 1'000 / OutputSampleRate;
+    m_samplesCount = samplesFlushed;
+    m_samplesRead = 0;
+    return samplesFlushed > 0;
 }
 
 } // namespace kb
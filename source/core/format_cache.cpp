@@ -0,0 +1,287 @@
+#include "core/format_cache.hpp"
+using namespace kb::FormatCacheConst;
+
+// STL modules
+#include <charconv>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+// Library {fmt}
+#include <fmt/format.h>
+
+// Custom modules
+#include "core/blocking_pool.hpp"
+#include "core/stopwatch.hpp"
+#include "core/utility.hpp"
+#include "ytcpp/format.hpp"
+
+namespace kb {
+
+/// @brief Get value of URL query parameter
+/// @param url The URL
+/// @param name Name of the parameter
+/// @return Raw value of the parameter: empty if the URL has no such parameter
+static std::string_view UrlParameter(std::string_view url, std::string_view name)
+{
+    size_t position = url.find('?');
+    while (position != std::string_view::npos)
+    {
+        ++position;
+        if (url.substr(position, name.size()) == name && url.substr(position + name.size(), 1) == "=")
+        {
+            std::string_view value = url.substr(position + name.size() + 1);
+            return value.substr(0, value.find('&'));
+        }
+        position = url.find('&', position);
+    }
+    return {};
+}
+
+/// @brief Get expiration time of signed URL from its "expire" parameter
+/// @param url The URL
+/// @return Expiration time: DefaultLifetime from now if the URL has no valid parameter
+static FormatCache::Clock::time_point UrlExpiration(std::string_view url)
+{
+    std::string_view value = UrlParameter(url, "expire");
+    int64_t timestamp = 0;
+    if (value.empty() || std::from_chars(value.data(), value.data() + value.size(), timestamp).ec != std::errc())
+        return FormatCache::Clock::now() + DefaultLifetime;
+    return FormatCache::Clock::time_point(std::chrono::seconds(timestamp));
+}
+
+/// @brief Get container of signed URL from its "mime" parameter, e.g. "webm" for "audio%2Fwebm"
+/// @param url The URL
+/// @return Short name of the container: empty if the URL has no "mime" parameter
+static std::string UrlContainer(std::string_view url)
+{
+    std::string_view value = UrlParameter(url, "mime");
+    size_t separator = value.rfind('/');
+    if (separator != std::string_view::npos)
+        return std::string(value.substr(separator + 1));
+
+    separator = value.find("%2");
+    if (separator != std::string_view::npos && separator + 3 <= value.size() && (value[separator + 2] == 'F' || value[separator + 2] == 'f'))
+        return std::string(value.substr(separator + 3));
+    return {};
+}
+
+FormatCache::FormatCache()
+    : m_logger(Utility::CreateLogger("format cache"))
+{}
+
+std::shared_ptr<const FormatCache::AudioFormat> FormatCache::find(const std::string& videoId)
+{
+    auto entry = m_entries.find(videoId);
+    if (entry == m_entries.end())
+        return {};
+
+    const Clock::time_point now = Clock::now();
+    if (entry->second.format->expiration - now < MinRemainingLifetime)
+    {
+        erase(entry);
+        return {};
+    }
+
+    entry->second.lastUse = now;
+    m_usage.splice(m_usage.end(), m_usage, entry->second.usage);
+    return entry->second.format;
+}
+
+void FormatCache::insert(const std::string& videoId, std::shared_ptr<const AudioFormat> format)
+{
+    const Clock::time_point now = Clock::now();
+    auto entry = m_entries.find(videoId);
+    if (entry == m_entries.end())
+    {
+        while (m_entries.size() >= MaxFormats)
+            erase(m_entries.find(m_usage.front()));
+
+        m_usage.push_back(videoId);
+        entry = m_entries.emplace(videoId, Entry{ nullptr, now, 0, std::prev(m_usage.end()) }).first;
+    }
+    else
+    {
+        // Refreshing doesn't count as use
+        Scheduler::Cancel(entry->second.refreshTimer);
+        entry->second.refreshTimer = 0;
+    }
+    entry->second.format = std::move(format);
+
+    const Clock::duration refreshDelay = entry->second.format->expiration - RefreshMargin - now;
+    if (refreshDelay > Clock::duration::zero())
+    {
+        entry->second.refreshTimer = Scheduler::Schedule(
+            [videoId]() { Instance().refresh(videoId); },
+            std::chrono::duration_cast<Scheduler::Clock::duration>(refreshDelay)
+        );
+    }
+}
+
+void FormatCache::erase(std::unordered_map<std::string, Entry>::iterator entry)
+{
+    if (entry->second.refreshTimer)
+        Scheduler::Cancel(entry->second.refreshTimer);
+    m_usage.erase(entry->second.usage);
+    m_entries.erase(entry);
+}
+
+std::shared_ptr<const FormatCache::AudioFormat> FormatCache::get(const std::string& videoId, bool refresh)
+{
+    std::promise<std::shared_ptr<const AudioFormat>> promise;
+    std::unique_lock lock(m_mutex);
+    if (!refresh)
+    {
+        if (std::shared_ptr<const AudioFormat> format = find(videoId))
+            return format;
+    }
+
+    auto pendingFormat = m_pendingFormats.find(videoId);
+    if (pendingFormat != m_pendingFormats.end())
+    {
+        std::shared_future<std::shared_ptr<const AudioFormat>> future = pendingFormat->second;
+        lock.unlock();
+        return future.get();
+    }
+
+    m_pendingFormats.emplace(videoId, promise.get_future().share());
+    lock.unlock();
+
+    // Resolving waits for YouTube, so it's done unlocked. Failures aren't cached.
+    std::shared_ptr<const AudioFormat> format;
+    Stopwatch stopwatch;
+    try
+    {
+        format = Resolve(videoId);
+    }
+    catch (...)
+    {
+        lock.lock();
+        m_pendingFormats.erase(videoId);
+        lock.unlock();
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    m_logger.info("Resolved audio URL of \"{}\" in {:.0f} ms", videoId, stopwatch.milliseconds());
+
+    lock.lock();
+    insert(videoId, format);
+    m_pendingFormats.erase(videoId);
+    lock.unlock();
+    promise.set_value(format);
+    return format;
+}
+
+void FormatCache::refresh(const std::string& videoId)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        auto entry = m_entries.find(videoId);
+        if (entry == m_entries.end())
+            return;
+
+        entry->second.refreshTimer = 0;
+        if (Clock::now() - entry->second.lastUse >= RefreshIdleLimit)
+        {
+            erase(entry);
+            return;
+        }
+    }
+
+    // Resolving waits for YouTube, so it doesn't run on scheduler workers
+    const bool deferred = BlockingPool::Defer(RefreshPoolKey, [videoId]()
+    {
+        FormatCache& cache = Instance();
+        try
+        {
+            cache.get(videoId, true);
+        }
+        catch (const std::exception& error)
+        {
+            cache.m_logger.warn("Couldn't refresh audio URL of \"{}\": {}", videoId, error.what());
+        }
+    });
+    if (deferred)
+        return;
+
+    // URL is still valid for a while, so the refresh is tried again instead of being resolved on playback
+    std::lock_guard lock(m_mutex);
+    auto entry = m_entries.find(videoId);
+    if (entry == m_entries.end() || entry->second.refreshTimer)
+        return;
+
+    m_logger.info("Refresh of audio URL of \"{}\" is postponed: Blocking pool is busy", videoId);
+    entry->second.refreshTimer = Scheduler::Schedule(
+        [videoId]() { Instance().refresh(videoId); },
+        std::chrono::duration_cast<Scheduler::Clock::duration>(RefreshRetryDelay)
+    );
+}
+
+std::shared_ptr<const FormatCache::AudioFormat> FormatCache::Resolve(const std::string& videoId)
+{
+    ytcpp::Format::List formats(videoId);
+    std::shared_ptr<const ytcpp::Format::Base> bestFormat;
+    for (const ytcpp::Format::Instance& format : formats)
+    {
+        if (format->type() != ytcpp::Format::Type::Audio)
+            continue;
+
+        if (bestFormat && format->bitrate() < bestFormat->bitrate())
+            continue;
+        bestFormat = format;
+    }
+
+    if (!bestFormat)
+    {
+        throw std::runtime_error(fmt::format(
+            "kb::FormatCache::Resolve(): "
+            "Video has no audio formats [video: \"{}\"]",
+            videoId
+        ));
+    }
+    const std::string& url = bestFormat->url();
+    return std::make_shared<const AudioFormat>(AudioFormat{ url, bestFormat->bitrate(), UrlExpiration(url), UrlContainer(url) });
+}
+
+std::shared_ptr<const FormatCache::AudioFormat> FormatCache::Get(const std::string& videoId)
+{
+    return Instance().get(videoId, false);
+}
+
+void FormatCache::Prefetch(const std::string& videoId, uint64_t key)
+{
+    FormatCache& cache = Instance();
+    {
+        std::lock_guard lock(cache.m_mutex);
+        if (cache.find(videoId) || cache.m_pendingFormats.contains(videoId))
+            return;
+    }
+
+    const bool deferred = BlockingPool::Defer(key, [videoId]()
+    {
+        try
+        {
+            Get(videoId);
+        }
+        catch (const std::exception& error)
+        {
+            // Playing the video resolves it again and reports the error
+            Instance().m_logger.warn("Couldn't prefetch audio URL of \"{}\": {}", videoId, error.what());
+        }
+    });
+    if (!deferred)
+        cache.m_logger.info("Audio URL of \"{}\" isn't prefetched: Blocking pool is busy", videoId);
+}
+
+void FormatCache::Invalidate(const std::string& videoId)
+{
+    FormatCache& cache = Instance();
+    std::lock_guard lock(cache.m_mutex);
+    auto entry = cache.m_entries.find(videoId);
+    if (entry != cache.m_entries.end())
+        cache.erase(entry);
+}
+
+} // namespace kb
@@ -0,0 +1,38 @@
+#include "core/frame_pool.hpp"
+using namespace kb::FramePoolConst;
+
+namespace kb {
+
+FramePool::FramePool()
+{
+    // Returning buffers must not allocate
+    m_buffers.reserve(MaxIdleBuffers);
+}
+
+FramePool::Buffer FramePool::Acquire()
+{
+    FramePool& pool = Instance();
+    {
+        std::lock_guard lock(pool.m_mutex);
+        if (!pool.m_buffers.empty())
+        {
+            Buffer buffer = std::move(pool.m_buffers.back());
+            pool.m_buffers.pop_back();
+            return buffer;
+        }
+    }
+    return std::make_unique_for_overwrite<uint8_t[]>(BufferSize);
+}
+
+void FramePool::Release(Buffer buffer)
+{
+    if (!buffer)
+        return;
+
+    FramePool& pool = Instance();
+    std::lock_guard lock(pool.m_mutex);
+    if (pool.m_buffers.size() < MaxIdleBuffers)
+        pool.m_buffers.push_back(std::move(buffer));
+}
+
+} // namespace kb
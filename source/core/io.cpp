@@ -1,8 +1,22 @@
 #include "core/io.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+    #include <share.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
 #include "core/error.hpp"
 
 namespace kb {
@@ -24,4 +38,90 @@ std::string IO::ReadFile(const std::string& fileName) {
     return buffer.str();
 }
 
+#ifdef _WIN32
+
+int IO::OpenForWriting(const std::string& fileName, bool append) {
+    int descriptor = -1;
+    int flags = _O_WRONLY | _O_CREAT | _O_BINARY | _O_NOINHERIT | (append ? _O_APPEND : _O_TRUNC);
+    _sopen_s(&descriptor, fileName.c_str(), flags, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+    return descriptor;
+}
+
+int64_t IO::FileSize(int descriptor) {
+    return _lseeki64(descriptor, 0, SEEK_END);
+}
+
+bool IO::WriteAll(int descriptor, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        int result = _write(descriptor, data.data() + written, static_cast<unsigned int>(std::min<size_t>(data.size() - written, INT_MAX)));
+        if (result < 0)
+            return false;
+        written += result;
+    }
+    return true;
+}
+
+bool IO::SyncFile(int descriptor) {
+    // Flushes the file buffers with FlushFileBuffers()
+    return _commit(descriptor) == 0;
+}
+
+bool IO::TruncateFile(int descriptor, uint64_t size) {
+    return _chsize_s(descriptor, static_cast<__int64>(size)) == 0;
+}
+
+void IO::CloseFile(int descriptor) {
+    _close(descriptor);
+}
+
+void IO::SyncDirectory(const std::string&) {}
+
+#else
+
+int IO::OpenForWriting(const std::string& fileName, bool append) {
+    return ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+}
+
+int64_t IO::FileSize(int descriptor) {
+    return ::lseek(descriptor, 0, SEEK_END);
+}
+
+bool IO::WriteAll(int descriptor, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = ::write(descriptor, data.data() + written, data.size() - written);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        written += result;
+    }
+    return true;
+}
+
+bool IO::SyncFile(int descriptor) {
+    return ::fdatasync(descriptor) == 0;
+}
+
+bool IO::TruncateFile(int descriptor, uint64_t size) {
+    return ::ftruncate(descriptor, static_cast<off_t>(size)) == 0;
+}
+
+void IO::CloseFile(int descriptor) {
+    ::close(descriptor);
+}
+
+void IO::SyncDirectory(const std::string& fileName) {
+    std::string directory = std::filesystem::path(fileName).parent_path().string();
+    int descriptor = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (descriptor < 0)
+        return;
+    ::fsync(descriptor);
+    ::close(descriptor);
+}
+
+#endif
+
 } // namespace kb
@@ -0,0 +1,62 @@
+#include "core/range_set.hpp"
+
+// STL modules
+#include <algorithm>
+
+namespace kb {
+
+RangeSet::RangeSet()
+    : m_size(0)
+{}
+
+void RangeSet::insert(uint64_t start, uint64_t end)
+{
+    if (start >= end)
+        return;
+
+    // Range before the new one may overlap or touch it
+    auto range = m_ranges.upper_bound(start);
+    if (range != m_ranges.begin() && std::prev(range)->second >= start)
+        range = std::prev(range);
+
+    // Absorb all ranges overlapping or touching the new one
+    while (range != m_ranges.end() && range->first <= end)
+    {
+        start = std::min(start, range->first);
+        end = std::max(end, range->second);
+        m_size -= range->second - range->first;
+        range = m_ranges.erase(range);
+    }
+
+    m_ranges.emplace(start, end);
+    m_size += end - start;
+}
+
+void RangeSet::clear()
+{
+    m_ranges.clear();
+    m_size = 0;
+}
+
+uint64_t RangeSet::rangeEnd(uint64_t position) const
+{
+    auto range = m_ranges.upper_bound(position);
+    if (range == m_ranges.begin())
+        return position;
+
+    range = std::prev(range);
+    return range->second > position ? range->second : position;
+}
+
+uint64_t RangeSet::nextStart(uint64_t position) const
+{
+    auto range = m_ranges.upper_bound(position);
+    return range == m_ranges.end() ? End : range->first;
+}
+
+bool RangeSet::covers(uint64_t start, uint64_t end) const
+{
+    return start >= end || rangeEnd(start) >= end;
+}
+
+} // namespace kb
@@ -0,0 +1,59 @@
+#include "core/ring_buffer.hpp"
+
+// STL modules
+#include <algorithm>
+
+namespace kb {
+
+RingBuffer::RingBuffer(size_t capacity)
+    : m_data(std::make_unique<uint8_t[]>(capacity))
+    , m_capacity(capacity)
+    , m_head(0)
+    , m_size(0)
+{}
+
+size_t RingBuffer::push(const uint8_t* data, size_t length)
+{
+    length = std::min(length, free());
+    size_t tail = (m_head + m_size) % m_capacity;
+
+    // The bytes may wrap around the end of the storage
+    size_t firstPart = std::min(length, m_capacity - tail);
+    std::copy(data, data + firstPart, m_data.get() + tail);
+    std::copy(data + firstPart, data + length, m_data.get());
+
+    m_size += length;
+    return length;
+}
+
+size_t RingBuffer::peek(size_t offset, uint8_t* buffer, size_t length) const
+{
+    if (offset >= m_size)
+        return 0;
+
+    length = std::min(length, m_size - offset);
+    size_t start = (m_head + offset) % m_capacity;
+
+    size_t firstPart = std::min(length, m_capacity - start);
+    std::copy(m_data.get() + start, m_data.get() + start + firstPart, buffer);
+    std::copy(m_data.get(), m_data.get() + length - firstPart, buffer + firstPart);
+    return length;
+}
+
+size_t RingBuffer::discard(size_t length)
+{
+    length = std::min(length, m_size);
+    m_head = (m_head + length) % m_capacity;
+    m_size -= length;
+    if (m_size == 0)
+        m_head = 0;
+    return length;
+}
+
+void RingBuffer::clear()
+{
+    m_head = 0;
+    m_size = 0;
+}
+
+} // namespace kb
@@ -0,0 +1,140 @@
+#include "core/scheduler.hpp"
+using namespace kb::SchedulerConst;
+
+// STL modules
+#include <algorithm>
+
+// Custom modules
+#include "core/utility.hpp"
+
+namespace kb {
+
+thread_local Scheduler::Worker* Scheduler::CurrentWorker = nullptr;
+
+Scheduler::Scheduler()
+    : m_logger(Utility::CreateLogger("scheduler"))
+    , m_nextWorker(0)
+    , m_queuedTasks(0)
+    , m_stopped(false)
+{
+    size_t workerCount = std::max<size_t>(std::thread::hardware_concurrency(), MinWorkers);
+    for (size_t index = 0; index < workerCount; ++index)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers.back()->index = index;
+    }
+
+    // Workers may steal from each other as soon as they start, so all of them must exist by then
+    for (const auto& worker : m_workers)
+        worker->thread = std::thread(&Scheduler::threadFunction, this, worker.get());
+    m_logger.info("Started {} workers", workerCount);
+}
+
+Scheduler::~Scheduler()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopped = true;
+        m_cv.notify_all();
+    }
+
+    for (const auto& worker : m_workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+}
+
+void Scheduler::threadFunction(Worker* worker)
+{
+    CurrentWorker = worker;
+    while (true)
+    {
+        Task task;
+        if (pop(*worker, task))
+        {
+            try
+            {
+                task();
+            }
+            catch (const std::exception& error)
+            {
+                m_logger.error("Task failed: {}", error.what());
+            }
+            catch (...)
+            {
+                m_logger.error("Task failed: Unknown error");
+            }
+            continue;
+        }
+
+        // Tasks might have been posted while other queues were searched
+        std::unique_lock lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_stopped || m_queuedTasks > 0; });
+        if (m_stopped)
+            return;
+    }
+}
+
+void Scheduler::push(Worker& worker, Task task)
+{
+    {
+        std::lock_guard lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+        ++m_queuedTasks;
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_cv.notify_one();
+}
+
+bool Scheduler::pop(Worker& worker, Task& task)
+{
+    {
+        std::lock_guard lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            task = std::move(worker.tasks.front());
+            worker.tasks.pop_front();
+            --m_queuedTasks;
+            return true;
+        }
+    }
+
+    // Victims lose their most recently posted tasks: the oldest ones are likely to run soon anyway
+    for (size_t offset = 1; offset < m_workers.size(); ++offset)
+    {
+        Worker& victim = *m_workers[(worker.index + offset) % m_workers.size()];
+        std::lock_guard lock(victim.mutex);
+        if (victim.tasks.empty())
+            continue;
+
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        --m_queuedTasks;
+        return true;
+    }
+    return false;
+}
+
+void Scheduler::Post(Task task)
+{
+    Scheduler& scheduler = Instance();
+    Worker* worker = CurrentWorker;
+    if (!worker)
+        worker = scheduler.m_workers[scheduler.m_nextWorker++ % scheduler.m_workers.size()].get();
+    scheduler.push(*worker, std::move(task));
+}
+
+Scheduler::TimerId Scheduler::Schedule(Task task, Clock::duration delay)
+{
+    // Wheel thread only hands the task over, workers run it
+    return TimerWheel::Arm([task = std::move(task)]() { Post(task); }, delay);
+}
+
+bool Scheduler::Cancel(TimerId timerId)
+{
+    return TimerWheel::Cancel(timerId);
+}
+
+} // namespace kb
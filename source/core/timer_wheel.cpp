@@ -0,0 +1,218 @@
+#include "core/timer_wheel.hpp"
+using namespace kb::TimerWheelConst;
+
+// STL modules
+#include <algorithm>
+
+namespace kb {
+
+/// @brief Get position of level's slot index in tick number
+/// @param level Wheel level
+/// @return Bit shift of the level
+static constexpr int LevelShift(int level)
+{
+    return level == 0 ? 0 : RootBits + (level - 1) * LevelBits;
+}
+
+TimerWheel::TimerWheel()
+    : m_stopped(false)
+    , m_startTime(Clock::now())
+    , m_tick(0)
+    , m_lastTimerId(0)
+    , m_runningTimer(0)
+{
+    m_levels[0].resize(RootSlots);
+    for (int level = 1; level < LevelCount; ++level)
+        m_levels[level].resize(LevelSlots);
+    m_thread = std::thread(&TimerWheel::threadFunction, this);
+}
+
+TimerWheel::~TimerWheel()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopped = true;
+        m_cv.notify_all();
+    }
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void TimerWheel::threadFunction()
+{
+    std::unique_lock lock(m_mutex);
+    while (!m_stopped)
+    {
+        uint64_t nowTick = tickAt(Clock::now(), false);
+        while (m_tick < nowTick)
+            advance();
+        runExpired(lock);
+
+        // Without timers nothing happens until one is armed
+        if (m_timers.empty())
+            m_cv.wait(lock);
+        else
+            m_cv.wait_until(lock, m_startTime + nextEventTick() * TickDuration);
+    }
+}
+
+uint64_t TimerWheel::tickAt(Clock::time_point time, bool roundUp) const
+{
+    if (time <= m_startTime)
+        return 0;
+
+    auto elapsed = time - m_startTime;
+    uint64_t ticks = elapsed / TickDuration;
+    if (roundUp && elapsed % TickDuration != Clock::duration::zero())
+        ++ticks;
+    return ticks;
+}
+
+void TimerWheel::insert(TimerId timerId, Timer& timer)
+{
+    // Finest level that covers the delay, the coarsest one takes everything else
+    uint64_t ticks = timer.expiry > m_tick ? timer.expiry - m_tick : 0;
+    int level = 0;
+    uint64_t span = RootSlots;
+    while (level < LevelCount - 1 && ticks >= span)
+    {
+        ++level;
+        span <<= LevelBits;
+    }
+
+    uint64_t expiry = std::min(timer.expiry, m_tick + span - 1);
+    uint64_t slotCount = level == 0 ? RootSlots : LevelSlots;
+    Slot& slot = m_levels[level][(expiry >> LevelShift(level)) & (slotCount - 1)];
+    timer.slot = &slot;
+    timer.position = slot.insert(slot.end(), timerId);
+}
+
+void TimerWheel::unlink(Timer& timer)
+{
+    if (!timer.slot)
+        return;
+
+    timer.slot->erase(timer.position);
+    timer.slot = nullptr;
+}
+
+void TimerWheel::advance()
+{
+    ++m_tick;
+
+    // When a level wraps around, the next slot of the coarser level is spread over the finer ones
+    if ((m_tick & (RootSlots - 1)) == 0)
+    {
+        for (int level = 1; level < LevelCount; ++level)
+        {
+            uint64_t index = (m_tick >> LevelShift(level)) & (LevelSlots - 1);
+            Slot cascaded;
+            cascaded.swap(m_levels[level][index]);
+            for (TimerId timerId : cascaded)
+            {
+                Timer& timer = m_timers.at(timerId);
+                insert(timerId, timer);
+            }
+
+            if (index != 0)
+                break;
+        }
+    }
+
+    Slot& slot = m_levels[0][m_tick & (RootSlots - 1)];
+    for (TimerId timerId : slot)
+    {
+        m_timers.at(timerId).slot = nullptr;
+        m_expired.push_back(timerId);
+    }
+    slot.clear();
+}
+
+uint64_t TimerWheel::nextEventTick() const
+{
+    uint64_t nextCascade = (m_tick | (RootSlots - 1)) + 1;
+    for (uint64_t tick = m_tick + 1; tick < nextCascade; ++tick)
+    {
+        if (!m_levels[0][tick & (RootSlots - 1)].empty())
+            return tick;
+    }
+    return nextCascade;
+}
+
+void TimerWheel::runExpired(std::unique_lock<std::mutex>& lock)
+{
+    std::vector<TimerId> expired;
+    expired.swap(m_expired);
+    for (TimerId timerId : expired)
+    {
+        // Timer might have been cancelled or reset while earlier callbacks ran
+        auto timer = m_timers.find(timerId);
+        if (timer == m_timers.end() || timer->second.slot)
+            continue;
+
+        Callback callback = std::move(timer->second.callback);
+        m_timers.erase(timer);
+
+        m_runningTimer = timerId;
+        lock.unlock();
+        callback();
+        lock.lock();
+        m_runningTimer = 0;
+        m_callbackCv.notify_all();
+    }
+}
+
+TimerWheel::TimerId TimerWheel::Arm(Callback callback, Clock::duration delay)
+{
+    TimerWheel& wheel = Instance();
+    std::lock_guard lock(wheel.m_mutex);
+
+    // Idle wheel thread doesn't advance, so it skips the ticks when a timer appears
+    uint64_t nowTick = wheel.tickAt(Clock::now(), false);
+    if (wheel.m_timers.empty() && wheel.m_expired.empty())
+        wheel.m_tick = std::max(wheel.m_tick, nowTick);
+
+    TimerId timerId = ++wheel.m_lastTimerId;
+    Timer& timer = wheel.m_timers[timerId];
+    timer.callback = std::move(callback);
+    timer.expiry = std::max(wheel.tickAt(Clock::now() + delay, true), wheel.m_tick + 1);
+    wheel.insert(timerId, timer);
+    wheel.m_cv.notify_all();
+    return timerId;
+}
+
+bool TimerWheel::Reset(TimerId timerId, Clock::duration delay)
+{
+    TimerWheel& wheel = Instance();
+    std::lock_guard lock(wheel.m_mutex);
+    auto timer = wheel.m_timers.find(timerId);
+    if (timer == wheel.m_timers.end())
+        return false;
+
+    wheel.unlink(timer->second);
+    timer->second.expiry = std::max(wheel.tickAt(Clock::now() + delay, true), wheel.m_tick + 1);
+    wheel.insert(timerId, timer->second);
+    wheel.m_cv.notify_all();
+    return true;
+}
+
+bool TimerWheel::Cancel(TimerId timerId)
+{
+    TimerWheel& wheel = Instance();
+    std::unique_lock lock(wheel.m_mutex);
+    auto timer = wheel.m_timers.find(timerId);
+    if (timer != wheel.m_timers.end())
+    {
+        wheel.unlink(timer->second);
+        wheel.m_timers.erase(timer);
+        return true;
+    }
+
+    // Callback calling this function would wait for itself
+    if (std::this_thread::get_id() != wheel.m_thread.get_id())
+        wheel.m_callbackCv.wait(lock, [&wheel, timerId]() { return wheel.m_runningTimer != timerId; });
+    return false;
+}
+
+} // namespace kb
@@ -0,0 +1,249 @@
+#include "core/transfer_engine.hpp"
+using namespace kb::TransferEngineConst;
+
+// STL modules
+#include <future>
+#include <stdexcept>
+
+// Library {fmt}
+#include <fmt/format.h>
+
+// Custom modules
+#include "core/utility.hpp"
+
+namespace kb {
+
+void TransferEngine::LockShare(CURL* handle, curl_lock_data data, curl_lock_access access, TransferEngine* engine)
+{
+    engine->m_shareMutexes[data].lock();
+}
+
+void TransferEngine::UnlockShare(CURL* handle, curl_lock_data data, TransferEngine* engine)
+{
+    engine->m_shareMutexes[data].unlock();
+}
+
+TransferEngine::TransferEngine()
+    : m_logger(Utility::CreateLogger("transfer engine"))
+    , m_multi(nullptr)
+    , m_share(nullptr)
+    , m_stopped(false)
+{
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    m_multi = curl_multi_init();
+    if (!m_multi)
+        throw std::runtime_error("kb::TransferEngine::TransferEngine(): Couldn't initialize Curl multi handle");
+    curl_multi_setopt(m_multi, CURLMOPT_MAXCONNECTS, MaxConnections);
+
+    /*
+    *   Audio is served by a handful of hosts, so tracks and seeks mostly go to the same one.
+    *   Sharing resolved names, TLS sessions and open connections between handles skips the handshakes.
+    */
+    m_share = curl_share_init();
+    if (!m_share)
+    {
+        curl_multi_cleanup(m_multi);
+        throw std::runtime_error("kb::TransferEngine::TransferEngine(): Couldn't initialize Curl share handle");
+    }
+    curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, &TransferEngine::LockShare);
+    curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, &TransferEngine::UnlockShare);
+    curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    m_thread = std::thread(&TransferEngine::threadFunction, this);
+}
+
+TransferEngine::~TransferEngine()
+{
+    post([this]() { m_stopped = true; });
+    if (m_thread.joinable())
+        m_thread.join();
+
+    for (const auto& transfer : m_transfers)
+        curl_multi_remove_handle(m_multi, transfer.first);
+    curl_multi_cleanup(m_multi);
+
+    for (CURL* easy : m_idleHandles)
+        curl_easy_cleanup(easy);
+    curl_share_cleanup(m_share);
+}
+
+void TransferEngine::threadFunction()
+{
+    while (true)
+    {
+        std::vector<Command> commands;
+        {
+            std::lock_guard lock(m_mutex);
+            commands.swap(m_commands);
+        }
+
+        for (const Command& command : commands)
+            command();
+        if (m_stopped)
+            return;
+
+        int runningTransfers = 0;
+        CURLMcode result = curl_multi_perform(m_multi, &runningTransfers);
+        if (result != CURLM_OK)
+            m_logger.error("Couldn't perform transfers: {}", curl_multi_strerror(result));
+
+        int messagesLeft = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &messagesLeft))
+        {
+            if (message->msg != CURLMSG_DONE)
+                continue;
+
+            CURL* easy = message->easy_handle;
+            CURLcode transferResult = message->data.result;
+            curl_multi_remove_handle(m_multi, easy);
+
+            auto transfer = m_transfers.find(easy);
+            if (transfer == m_transfers.end())
+                continue;
+            DoneCallback done = std::move(transfer->second);
+            m_transfers.erase(transfer);
+            done(transferResult);
+        }
+
+        // Wakes up on socket activity, timeout or new command
+        result = curl_multi_poll(m_multi, nullptr, 0, 1000, nullptr);
+        if (result != CURLM_OK)
+            m_logger.error("Couldn't poll transfers: {}", curl_multi_strerror(result));
+    }
+}
+
+void TransferEngine::post(Command command)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_commands.push_back(std::move(command));
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+void TransferEngine::execute(const Command& command)
+{
+    if (std::this_thread::get_id() == m_thread.get_id())
+    {
+        command();
+        return;
+    }
+
+    std::promise<void> executed;
+    std::future<void> future = executed.get_future();
+    post([&command, &executed]()
+    {
+        command();
+        executed.set_value();
+    });
+    future.wait();
+}
+
+void TransferEngine::removeTransfer(CURL* easy)
+{
+    m_failedTransfers.erase(easy);
+
+    auto transfer = m_transfers.find(easy);
+    if (transfer == m_transfers.end())
+        return;
+
+    curl_multi_remove_handle(m_multi, easy);
+    m_transfers.erase(transfer);
+}
+
+void TransferEngine::failTransfer(CURL* easy)
+{
+    auto transfer = m_failedTransfers.find(easy);
+    if (transfer == m_failedTransfers.end())
+        return;
+
+    DoneCallback done = std::move(transfer->second);
+    m_failedTransfers.erase(transfer);
+    done(CURLE_FAILED_INIT);
+}
+
+CURL* TransferEngine::Acquire()
+{
+    TransferEngine& engine = Instance();
+    CURL* easy = nullptr;
+    {
+        std::lock_guard lock(engine.m_mutex);
+        if (!engine.m_idleHandles.empty())
+        {
+            easy = engine.m_idleHandles.back();
+            engine.m_idleHandles.pop_back();
+        }
+    }
+
+    if (!easy)
+        easy = curl_easy_init();
+    if (!easy)
+        return nullptr;
+
+    curl_easy_setopt(easy, CURLOPT_SHARE, engine.m_share);
+    curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, DnsCacheTimeout);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    return easy;
+}
+
+void TransferEngine::Release(CURL* easy)
+{
+    if (!easy)
+        return;
+
+    TransferEngine& engine = Instance();
+    curl_easy_reset(easy);
+
+    std::lock_guard lock(engine.m_mutex);
+    if (engine.m_idleHandles.size() < MaxIdleHandles)
+        engine.m_idleHandles.push_back(easy);
+    else
+        curl_easy_cleanup(easy);
+}
+
+void TransferEngine::Add(CURL* easy, DoneCallback done)
+{
+    TransferEngine& engine = Instance();
+    auto command = [&engine, easy, done = std::move(done)]() mutable
+    {
+        CURLMcode result = curl_multi_add_handle(engine.m_multi, easy);
+        if (result != CURLM_OK)
+        {
+            engine.m_logger.error("Couldn't add transfer: {}", curl_multi_strerror(result));
+
+            // Caller may still hold locks the callback needs, and may remove the transfer before it runs
+            engine.m_failedTransfers[easy] = std::move(done);
+            engine.post([&engine, easy]() { engine.failTransfer(easy); });
+            return;
+        }
+        engine.m_transfers[easy] = std::move(done);
+    };
+
+    // Transfer may be restarted from its own done callback
+    if (std::this_thread::get_id() == engine.m_thread.get_id())
+        command();
+    else
+        engine.post(std::move(command));
+}
+
+void TransferEngine::Resume(CURL* easy)
+{
+    TransferEngine& engine = Instance();
+    engine.post([&engine, easy]()
+    {
+        // Transfer might have been removed while the command was waiting
+        if (engine.m_transfers.contains(easy))
+            curl_easy_pause(easy, CURLPAUSE_CONT);
+    });
+}
+
+void TransferEngine::Remove(CURL* easy)
+{
+    TransferEngine& engine = Instance();
+    engine.execute([&engine, easy]() { engine.removeTransfer(easy); });
+}
+
+} // namespace kb
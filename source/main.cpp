@@ -3,6 +3,7 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 // STL modules
+#include <csignal>
 #include <filesystem>
 
 // Library {fmt}
@@ -14,6 +15,9 @@
 // Custom modules
 #include "bot/bot.hpp"
 #include "bot/info.hpp"
+#include "bot/info_cache.hpp"
+#include "bot/info_storage.hpp"
+#include "bot/locale/locales.hpp"
 #include "core/config.hpp"
 #include "core/utility.hpp"
 using namespace kb;
@@ -26,6 +30,7 @@ struct ParseResult
         ShowHelp,   // Help message was requested
         Generate,   // Necessary files generation was requested
         Register,   // Commands registering was requested
+        Migrate,    // Info files migration was requested
         Start,      // Normal bot start was requested
     };
 
@@ -79,6 +84,12 @@ static ParseResult ParseOptions(int argc, char** argv)
             continue;
         }
 
+        if (option == "-m" || option == "--migrate")
+        {
+            result.result = ParseResult::Result::Migrate;
+            continue;
+        }
+
         fmt::print(
             "Unknown option: \"{}\"\n"
             "See {} --help\n",
@@ -106,6 +117,7 @@ static int ShowHelpMessage(const ParseResult& result)
         "    -h, --help\t\tShow this message and exit\n"
         "    -g, --generate\tGenerate necessary files and exit\n"
         "    -r, --register\tRegister slashcommands and exit\n"
+        "    -m, --migrate\tMove guild info from JSON files to info log and exit\n"
         "Only one of the unique options may be passed at the same time. All others will be ignored.\n",
         result.executableName
     );
@@ -168,6 +180,50 @@ static int GenerateFiles()
     return 0;
 }
 
+/// @brief Move guild info from legacy JSON files to info log
+/// @return Executable exit code
+static int MigrateInfo()
+{
+    std::string logPath = fmt::format("{}/{}", Bot::InfoConst::InfoDirectory, Bot::InfoStorageConst::LogFilename);
+    if (std::filesystem::exists(logPath))
+    {
+        fmt::print(
+            "Info log \"{}\" already exists.\n"
+            "Delete it first to confirm that you don't care about its contents.\n",
+            logPath
+        );
+        return 1;
+    }
+
+    Bot::InfoStorage::Records records;
+    try
+    {
+        records = Bot::JsonInfoStorage(Bot::InfoConst::InfoDirectory).load();
+    }
+    catch (const std::runtime_error& error)
+    {
+        fmt::print("Couldn't read info files: {}\n", error.what());
+        return 1;
+    }
+
+    if (!Bot::LogInfoStorage(logPath).write(records))
+    {
+        fmt::print(
+            "Couldn't write info log \"{}\".\n"
+            "Please check permissions.\n",
+            logPath
+        );
+        return 1;
+    }
+
+    fmt::print(
+        "Info of {} guild{} was moved to info log \"{}\".\n"
+        "JSON info files are not used anymore and may be deleted.\n",
+        records.size(), Bot::LocaleEn::Cardinal(records.size()), logPath
+    );
+    return 0;
+}
+
 /// @brief Check singletons initialization
 /// @param result Commandline arguments parse result
 /// @return True if all singletons initialized successfully
@@ -183,9 +239,46 @@ static bool CheckSingletons(const ParseResult& result)
         return false;
     }
 
+    // Starting without info log would silently reset info of guilds stored in JSON files
+    std::string logPath = fmt::format("{}/{}", Bot::InfoConst::InfoDirectory, Bot::InfoStorageConst::LogFilename);
+    std::error_code directoryError;
+    if (!std::filesystem::exists(logPath) && std::filesystem::is_directory(Bot::InfoConst::InfoDirectory))
+    {
+        for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(Bot::InfoConst::InfoDirectory, directoryError))
+        {
+            if (file.path().extension() != ".json")
+                continue;
+
+            logger.error("Info directory \"{}/\" contains JSON info files, but info log doesn't exist", Bot::InfoConst::InfoDirectory);
+            logger.info("Hint: Guild info from JSON files can be moved to info log by running {} --migrate", result.executableName);
+            return false;
+        }
+    }
+
+    try
+    {
+        Bot::InfoCache::Load();
+    }
+    catch (const std::runtime_error& error)
+    {
+        logger.error("Info loading error: {}", error.what());
+        logger.info("Hint: Check info log \"{}\"", logPath);
+        return false;
+    }
+
     return true;
 }
 
+/// @brief Set when termination signal is received
+static volatile std::sig_atomic_t TerminationRequested = 0;
+
+/// @brief Termination signal handler
+/// @param signal Received signal
+static void OnTerminationSignal(int signal)
+{
+    TerminationRequested = 1;
+}
+
 static void YtcppInit() {
     auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
     sink->set_pattern("[%^%d.%m.%C %H:%M:%S %L%$] [%n] %v");
@@ -206,6 +299,8 @@ int main(int argc, char** argv)
             return ShowHelpMessage(result);
         case ParseResult::Result::Generate:
             return GenerateFiles();
+        case ParseResult::Result::Migrate:
+            return MigrateInfo();
         default:
             break;
     }
@@ -226,6 +321,16 @@ int main(int argc, char** argv)
     );
 
     YtcppInit();
-    Bot::Bot bot;
-    bot.start(dpp::st_wait);
+    std::signal(SIGINT, &OnTerminationSignal);
+    std::signal(SIGTERM, &OnTerminationSignal);
+    {
+        Bot::Bot bot;
+        bot.start(dpp::st_return);
+        while (!TerminationRequested)
+            Utility::Sleep(0.2);
+    }
+
+    // Info changed while players were torn down must not be lost
+    Bot::InfoCache::Flush();
+    return 0;
 }